@@ -0,0 +1,46 @@
+/*
+ * cap_calib.c - 电容测量校准值的保存与载入
+ */
+
+#include "cap_calib.h"
+#include "nvstore.h"
+#include "onewire.h"
+#include "capacitance.h"
+
+typedef struct {
+    uint16 magic;
+    uint8 version;
+    uint8 crc;                                      // calibration 的CRC-8
+    CapCalibration calibration;
+} CapCalibRecord;
+
+uint8 cap_calib_load(void) {
+    CapCalibRecord record;
+    
+    if(nvstore_read(NVSTORE_CAP_CALIB_ADDR, &record, sizeof(record)) != NVSTORE_OK) {
+        return CAP_CALIB_ERR_STORE;
+    }
+    if(record.magic != CAP_CALIB_MAGIC || record.version != CAP_CALIB_VERSION) {
+        return CAP_CALIB_ERR_EMPTY;
+    }
+    if(onewire_crc8((const uint8*)&record.calibration, sizeof(record.calibration)) != record.crc) {
+        return CAP_CALIB_ERR_CRC;
+    }
+    
+    capacitance_set_calibration(&record.calibration);
+    return CAP_CALIB_OK;
+}
+
+uint8 cap_calib_save(void) {
+    CapCalibRecord record;
+    
+    record.magic = CAP_CALIB_MAGIC;
+    record.version = CAP_CALIB_VERSION;
+    record.calibration = *capacitance_calibration();
+    record.crc = onewire_crc8((const uint8*)&record.calibration, sizeof(record.calibration));
+    
+    return (nvstore_write(NVSTORE_CAP_CALIB_ADDR, &record, sizeof(record)) == NVSTORE_OK) ?
+           CAP_CALIB_OK : CAP_CALIB_ERR_STORE;
+}
+
+/* [] END OF FILE */
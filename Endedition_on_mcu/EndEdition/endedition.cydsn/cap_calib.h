@@ -0,0 +1,25 @@
+/*
+ * cap_calib.h - 电容测量校准值（零点、参考电容、温度漂移）的保存与载入
+ * 启动时在 capacitance_init() 之前载入，CAP_ZERO/CAP_REF/CAP_BASELINE 完成后保存
+ */
+
+#ifndef CAP_CALIB_H
+#define CAP_CALIB_H
+
+#include "project.h"
+
+#define CAP_CALIB_MAGIC         0xCA9Cu
+#define CAP_CALIB_VERSION       1u
+
+// 返回值
+#define CAP_CALIB_OK            0
+#define CAP_CALIB_ERR_EMPTY     1       // 没有保存过或版本不符
+#define CAP_CALIB_ERR_CRC       2
+#define CAP_CALIB_ERR_STORE     3
+
+uint8 cap_calib_load(void);
+uint8 cap_calib_save(void);
+
+#endif /* CAP_CALIB_H */
+
+/* [] END OF FILE */
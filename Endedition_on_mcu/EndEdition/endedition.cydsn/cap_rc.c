@@ -0,0 +1,59 @@
+/*
+ * cap_rc.c - RC充电计时测量源（电容测量的硬件部分）
+ */
+
+#include "cap_rc.h"
+
+#define CAP_RC_COUNTER_MASK     0xFFFFu
+
+// 充电/检测引脚由原理图生成，没有时不提供测量源
+#if defined(CY_PINS_Pin_CAP_CHARGE_H) && defined(CY_PINS_Pin_CAP_SENSE_H)
+    #define CAP_RC_AVAILABLE    1
+#else
+    #define CAP_RC_AVAILABLE    0
+#endif
+
+#if CAP_RC_AVAILABLE
+// 一次放电-充电计时；不关中断，被中断拉长的结果由 capacitance 取最小值剔除
+static uint8 rc_measure(uint16* ticks) {
+    uint16 start;
+    uint16 elapsed;
+    
+    Pin_CAP_CHARGE_Write(0);
+    Pin_CAP_SENSE_Write(0);
+    CyDelayUs(CAP_RC_DISCHARGE_US);
+    Pin_CAP_SENSE_Write(1);
+    
+    start = (uint16)Timer_1us_ReadCounter();
+    Pin_CAP_CHARGE_Write(1);
+    do {
+        elapsed = (uint16)((Timer_1us_ReadCounter() - start) & CAP_RC_COUNTER_MASK);
+        if(elapsed > CAP_RC_TIMEOUT_TICKS) {
+            Pin_CAP_CHARGE_Write(0);
+            return CAP_ERR_TIMEOUT;
+        }
+    } while(!Pin_CAP_SENSE_Read());
+    Pin_CAP_CHARGE_Write(0);
+    
+    *ticks = elapsed;
+    return CAP_OK;
+}
+
+static const CapSource rc_source = {
+    rc_measure,
+    CAP_RC_FF_PER_KILOTICK
+};
+#endif
+
+const CapSource* cap_rc_init(void) {
+#if CAP_RC_AVAILABLE
+    Pin_CAP_CHARGE_Write(0);
+    Pin_CAP_SENSE_SetDriveMode(Pin_CAP_SENSE_DM_OD_LO);
+    Pin_CAP_SENSE_Write(0);
+    return &rc_source;
+#else
+    return NULL;
+#endif
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,30 @@
+/*
+ * cap_rc.h - RC充电计时测量源（电容测量的硬件部分）
+ *
+ * 接线：Pin_CAP_CHARGE --R(CAP_RC_RESISTOR_OHMS)-- 测量点 -- Pin_CAP_SENSE
+ *       被测电容接在测量点与地之间。
+ * Pin_CAP_SENSE 配置为开漏低：写0放电，写1释放后作为数字输入。
+ * 充电脚拉高后用 Timer_1us 的自由运行计数器（12MHz，timebase 已启动）
+ * 计时，直到检测脚读到高电平（约0.7Vdd，t ≈ 1.2RC）。
+ * 原理图中没有这两个引脚时 cap_rc_init() 返回 NULL。
+ */
+
+#ifndef CAP_RC_H
+#define CAP_RC_H
+
+#include "project.h"
+#include "capacitance.h"
+
+#define CAP_RC_RESISTOR_OHMS        1000000u
+#define CAP_RC_TICKS_PER_US         12u         // Clock_2 = 12MHz
+#define CAP_RC_DISCHARGE_US         20u
+#define CAP_RC_TIMEOUT_TICKS        60000u      // 5ms，约4nF（16位计数器回绕之前）
+
+// 理论比例：1e18 / (12MHz x 1MΩ x ln(1/0.3)) = 69204 fF / 1000计数
+#define CAP_RC_FF_PER_KILOTICK      69204u
+
+const CapSource* cap_rc_init(void);
+
+#endif /* CAP_RC_H */
+
+/* [] END OF FILE */
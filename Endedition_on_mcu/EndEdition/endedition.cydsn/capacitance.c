@@ -0,0 +1,300 @@
+/*
+ * capacitance.c - 电容测量（充电计时 -> 平均 -> pF换算 -> 温度漂移补偿）
+ */
+
+#include "capacitance.h"
+
+// 时间回绕安全的到期判断（与 timebase.h 的 TIMEBASE_EXPIRED 相同）
+#define TIME_EXPIRED(now, deadline)     ((int32)((now) - (deadline)) >= 0)
+
+// 漂移学习：以第一个样本为原点累加，避免大数相乘
+// 样本数和偏差（温度±100°C、电容±100pF）有界，拟合的乘积在64位范围内
+typedef struct {
+    uint16 count;
+    int32 x0;                   // 温度，0.01°C
+    int32 y0;                   // 未补偿的电容，fF
+    int32 x_min;
+    int32 x_max;
+    int64 sum_x;
+    int64 sum_y;
+    int64 sum_xx;
+    int64 sum_xy;
+} BaselineFit;
+
+// ============ 模块状态 ============
+static const CapSource* source = NULL;
+static CapCalibration calibration = { 0, 0, 0, 2500, 0 };
+static CapStats stats;
+
+static uint16 interval_ms = CAP_SAMPLE_INTERVAL_MS;
+static uint32 next_sample_ms = 0;
+static uint32 backoff_ms = 0;           // 整组超时后的测量间隔，0 = 正常间隔
+static uint32 ticks_sum = 0;
+static uint8 ticks_count = 0;
+
+static uint8 value_valid = 0;
+static int32 value_ff = 0;
+
+static int32 temperature_x100 = 0;
+static uint8 temperature_valid = 0;
+static uint8 temperature_fresh = 0;     // 漂移学习每个温度读数只取一个样本
+
+static uint8 cal_status = CAP_CAL_IDLE;
+static uint8 cal_type = CAP_CAL_ZERO;
+static int32 cal_ref_ff = 0;
+
+static uint8 baseline_active = 0;
+static BaselineFit fit;
+
+// ============ 内部函数 ============
+// 平均计时换算为fF（相对零点，即扣除寄生电容）
+static int32 convert(uint32 ticks_x16) {
+    int32 delta = (int32)ticks_x16 - (int32)calibration.zero_ticks_x16;
+
+    if(calibration.ref_ff > 0 && calibration.ref_ticks_x16 > calibration.zero_ticks_x16) {
+        return (int32)((int64)delta * calibration.ref_ff /
+                       (int32)(calibration.ref_ticks_x16 - calibration.zero_ticks_x16));
+    }
+    return (int32)((int64)delta * (int32)source->ff_per_kilotick / 16000);
+}
+
+static void baseline_add(int32 raw_ff) {
+    int32 x;
+    int32 y;
+
+    if(!temperature_valid || !temperature_fresh || fit.count >= CAP_BASELINE_MAX_SAMPLES) {
+        return;
+    }
+    temperature_fresh = 0;
+    if(fit.count == 0) {
+        fit.x0 = temperature_x100;
+        fit.y0 = raw_ff;
+        fit.x_min = temperature_x100;
+        fit.x_max = temperature_x100;
+    }
+    if(temperature_x100 < fit.x_min) {
+        fit.x_min = temperature_x100;
+    }
+    if(temperature_x100 > fit.x_max) {
+        fit.x_max = temperature_x100;
+    }
+
+    x = temperature_x100 - fit.x0;
+    y = raw_ff - fit.y0;
+    fit.sum_x += x;
+    fit.sum_y += y;
+    fit.sum_xx += (int64)x * x;
+    fit.sum_xy += (int64)x * y;
+    fit.count++;
+}
+
+// 一个平均值完成：处理进行中的校准，换算并补偿
+static void process_average(uint32 ticks_x16) {
+    int32 raw_ff;
+
+    stats.last_ticks_x16 = ticks_x16;
+
+    if(cal_status == CAP_CAL_RUNNING) {
+        if(cal_type == CAP_CAL_ZERO) {
+            calibration.zero_ticks_x16 = ticks_x16;
+            if(temperature_valid) {
+                calibration.baseline_temp_x100 = temperature_x100;
+            }
+            cal_status = CAP_CAL_DONE;
+        } else if(ticks_x16 > calibration.zero_ticks_x16) {
+            calibration.ref_ticks_x16 = ticks_x16;
+            calibration.ref_ff = cal_ref_ff;
+            cal_status = CAP_CAL_DONE;
+        } else {
+            cal_status = CAP_CAL_FAILED;
+        }
+    }
+
+    raw_ff = convert(ticks_x16);
+    if(baseline_active) {
+        baseline_add(raw_ff);
+    }
+
+    value_ff = raw_ff;
+    if(temperature_valid) {
+        value_ff -= (int32)((int64)calibration.tempco_ff *
+                            (temperature_x100 - calibration.baseline_temp_x100) / 100);
+    }
+    value_valid = 1;
+}
+
+// ============ 对外接口 ============
+// source 为 NULL 表示没有测量硬件，之后所有读数无效；now_ms 为当前时间（timebase_ms）
+void capacitance_init(const CapSource* cap_source, uint32 now_ms) {
+    source = cap_source;
+    ticks_sum = 0;
+    ticks_count = 0;
+    value_valid = 0;
+    cal_status = CAP_CAL_IDLE;
+    baseline_active = 0;
+    stats.measurements = 0;
+    stats.timeouts = 0;
+    stats.last_ticks_x16 = 0;
+    backoff_ms = 0;
+    next_sample_ms = now_ms;
+}
+
+uint8 capacitance_available(void) {
+    return (source != NULL);
+}
+
+void capacitance_set_interval(uint16 ms) {
+    if(ms < 1) {
+        ms = 1;
+    } else if(ms > CAP_SAMPLE_INTERVAL_MAX_MS) {
+        ms = CAP_SAMPLE_INTERVAL_MAX_MS;
+    }
+    interval_ms = ms;
+}
+
+uint16 capacitance_interval(void) {
+    return interval_ms;
+}
+
+// 主循环调用，now_ms 为当前时间；产生新的平均值（或一次全部超时的测量）时返回1
+uint8 capacitance_poll(uint32 now_ms) {
+    uint16 ticks;
+    uint16 best = 0xFFFF;
+    uint8 measured = 0;
+    uint8 i;
+
+    if(source == NULL || !TIME_EXPIRED(now_ms, next_sample_ms)) {
+        return 0;
+    }
+    next_sample_ms = now_ms + interval_ms;
+
+    // 超时的测量已忙等了整个超时时间，本组其余测量不再进行
+    for(i = 0; i < CAP_BURST_COUNT; i++) {
+        if(source->measure(&ticks) != CAP_OK) {
+            stats.timeouts++;
+            break;
+        }
+        stats.measurements++;
+        measured = 1;
+        if(ticks < best) {
+            best = ticks;
+        }
+    }
+
+    // 整组超时：丢弃未完成的平均，读数无效，下次测量的间隔加倍
+    if(!measured) {
+        backoff_ms = backoff_ms ? backoff_ms * 2u : (uint32)interval_ms * 2u;
+        if(backoff_ms > CAP_TIMEOUT_BACKOFF_MAX_MS) {
+            backoff_ms = (interval_ms > CAP_TIMEOUT_BACKOFF_MAX_MS) ? interval_ms : CAP_TIMEOUT_BACKOFF_MAX_MS;
+        }
+        next_sample_ms = now_ms + backoff_ms;
+        ticks_sum = 0;
+        ticks_count = 0;
+        value_valid = 0;
+        if(cal_status == CAP_CAL_RUNNING) {
+            cal_status = CAP_CAL_FAILED;
+        }
+        return 1;
+    }
+
+    backoff_ms = 0;
+    ticks_sum += best;
+    if(++ticks_count < CAP_AVERAGE_COUNT) {
+        return 0;
+    }
+    process_average(ticks_sum * 16u / CAP_AVERAGE_COUNT);
+    ticks_sum = 0;
+    ticks_count = 0;
+    return 1;
+}
+
+uint8 capacitance_has_reading(void) {
+    return value_valid;
+}
+
+// 校准并补偿后的电容，fF
+int32 capacitance_ff(void) {
+    return value_ff;
+}
+
+// 温度补偿和漂移学习使用的温度，由主程序在温度更新时传入
+void capacitance_set_temperature(int32 temp_x100, uint8 valid) {
+    temperature_x100 = temp_x100;
+    temperature_valid = valid;
+    temperature_fresh = valid;
+}
+
+// 用下一个平均值做零点或参考校准，完成情况由 capacitance_calibration_status() 查询
+uint8 capacitance_calibrate(uint8 type, int32 ref_ff) {
+    if(source == NULL) {
+        return CAP_ERR_NO_SOURCE;
+    }
+    if(type == CAP_CAL_REF && ref_ff <= 0) {
+        return CAP_ERR_RANGE;
+    }
+    cal_type = type;
+    cal_ref_ff = ref_ff;
+    // 丢弃校准开始前已累加的部分
+    ticks_sum = 0;
+    ticks_count = 0;
+    cal_status = CAP_CAL_RUNNING;
+    return CAP_OK;
+}
+
+uint8 capacitance_calibration_status(void) {
+    return cal_status;
+}
+
+void capacitance_set_calibration(const CapCalibration* cal) {
+    calibration = *cal;
+}
+
+const CapCalibration* capacitance_calibration(void) {
+    return &calibration;
+}
+
+// 开始漂移学习：空载状态下让温度变化，期间的读数用于拟合
+uint8 capacitance_baseline_start(void) {
+    if(source == NULL) {
+        return CAP_ERR_NO_SOURCE;
+    }
+    fit.count = 0;
+    fit.sum_x = 0;
+    fit.sum_y = 0;
+    fit.sum_xx = 0;
+    fit.sum_xy = 0;
+    baseline_active = 1;
+    return CAP_OK;
+}
+
+// 结束学习，拟合 电容 = a + b x 温度，b 作为新的漂移系数
+uint8 capacitance_baseline_finish(void) {
+    int64 n = fit.count;
+    int64 denominator;
+
+    if(!baseline_active) {
+        return CAP_ERR_STATE;
+    }
+    baseline_active = 0;
+
+    if(fit.count < CAP_BASELINE_MIN_SAMPLES || fit.x_max - fit.x_min < CAP_BASELINE_MIN_SPAN_X100) {
+        return CAP_ERR_SPAN;
+    }
+    denominator = n * fit.sum_xx - fit.sum_x * fit.sum_x;
+    if(denominator <= 0) {
+        return CAP_ERR_SPAN;
+    }
+    // 斜率单位 fF/0.01°C，乘100换算为 fF/°C
+    calibration.tempco_ff = (int32)((n * fit.sum_xy - fit.sum_x * fit.sum_y) * 100 / denominator);
+    return CAP_OK;
+}
+
+uint8 capacitance_baseline_active(void) {
+    return baseline_active;
+}
+
+const CapStats* capacitance_stats(void) {
+    return &stats;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,91 @@
+/*
+ * capacitance.h - 电容测量（充电计时 -> 平均 -> pF换算 -> 温度漂移补偿）
+ *
+ * 测量源只提供"一次充电需要多少计数"（CapSource），本模块负责：
+ *   1. 每 CAP_SAMPLE_INTERVAL_MS 连续测 CAP_BURST_COUNT 次取最小值
+ *      （中断只会让计时变长，最小值最接近真实充电时间）；
+ *      一次超时后本组其余测量取消，整组超时时间隔加倍退避（最长 CAP_TIMEOUT_BACKOFF_MAX_MS），
+ *      开路时每个间隔只忙等一次超时，恢复测量后回到设定的间隔
+ *   2. CAP_AVERAGE_COUNT 次测量平均为一个输出值（计数的1/16为单位）
+ *   3. 两点校准换算为fF：空载（寄生电容）为零点，已知参考电容定比例；
+ *      没有参考校准时使用测量源给出的理论比例
+ *   4. 零点随温度漂移：按零点校准时的温度补偿；漂移系数可在空载时
+ *      跟踪温度变化自动拟合（CAP_BASELINE 学习，最小二乘）
+ * 测量源通过 capacitance_init() 注入，当前时间由调用者传入，本模块不访问硬件、
+ * 只用 project.h 中的整数类型：../test 中以模拟的计数源在PC上编译验证（make test）。
+ */
+
+#ifndef CAPACITANCE_H
+#define CAPACITANCE_H
+
+#include "project.h"
+
+#define CAP_SAMPLE_INTERVAL_MS      10      // 默认测量间隔
+#define CAP_SAMPLE_INTERVAL_MAX_MS  10000
+#define CAP_BURST_COUNT             4
+#define CAP_TIMEOUT_BACKOFF_MAX_MS  1000    // 整组超时后退避的最长间隔
+#define CAP_AVERAGE_COUNT           16      // 每个输出值 16 个测量间隔（默认约160ms）
+#define CAP_BASELINE_MIN_SAMPLES    8
+#define CAP_BASELINE_MAX_SAMPLES    4096    // 每个温度读数最多取一个样本，约1小时
+#define CAP_BASELINE_MIN_SPAN_X100  100     // 拟合漂移系数需要至少1°C的温度变化
+
+// 校准类型
+#define CAP_CAL_ZERO                0       // 空载
+#define CAP_CAL_REF                 1       // 已知参考电容
+
+// 校准状态
+#define CAP_CAL_IDLE                0
+#define CAP_CAL_RUNNING             1
+#define CAP_CAL_DONE                2
+#define CAP_CAL_FAILED              3
+
+// 返回值
+#define CAP_OK                      0
+#define CAP_ERR_NO_SOURCE           1
+#define CAP_ERR_TIMEOUT             2       // 测量源：充电超时（开路或电容过大）
+#define CAP_ERR_STATE               3
+#define CAP_ERR_RANGE               4       // 参考计时不大于零点
+#define CAP_ERR_SPAN                5       // 漂移学习的样本数或温度跨度不足
+
+typedef struct {
+    uint8 (*measure)(uint16* ticks);        // 一次放电-充电计时，CAP_OK / CAP_ERR_TIMEOUT
+    uint32 ff_per_kilotick;                 // 理论比例：每1000计数对应的fF
+} CapSource;
+
+typedef struct {
+    uint32 zero_ticks_x16;      // 空载平均计时（1/16计数）
+    uint32 ref_ticks_x16;       // 参考电容平均计时
+    int32 ref_ff;               // 参考电容值，0 = 未做参考校准
+    int32 baseline_temp_x100;   // 零点校准时的温度（0.01°C）
+    int32 tempco_ff;            // 零点漂移，fF/°C
+} CapCalibration;
+
+typedef struct {
+    uint32 measurements;        // 成功的充电计时次数
+    uint32 timeouts;
+    uint32 last_ticks_x16;
+} CapStats;
+
+void capacitance_init(const CapSource* source, uint32 now_ms);
+uint8 capacitance_available(void);
+void capacitance_set_interval(uint16 interval_ms);
+uint16 capacitance_interval(void);
+uint8 capacitance_poll(uint32 now_ms);
+uint8 capacitance_has_reading(void);
+int32 capacitance_ff(void);
+void capacitance_set_temperature(int32 temp_x100, uint8 valid);
+
+uint8 capacitance_calibrate(uint8 type, int32 ref_ff);
+uint8 capacitance_calibration_status(void);
+void capacitance_set_calibration(const CapCalibration* calibration);
+const CapCalibration* capacitance_calibration(void);
+
+uint8 capacitance_baseline_start(void);
+uint8 capacitance_baseline_finish(void);
+uint8 capacitance_baseline_active(void);
+
+const CapStats* capacitance_stats(void);
+
+#endif /* CAPACITANCE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,45 @@
+/*
+ * cdc_system.h - 主程序共享的系统状态与输出接口
+ * 供各功能模块访问 main.c 中的全局状态
+ */
+
+#ifndef CDC_SYSTEM_H
+#define CDC_SYSTEM_H
+
+#include "project.h"
+
+// ============ 系统状态 ============
+typedef enum {
+    STATUS_READY,
+    STATUS_MOVING,
+    STATUS_ERROR,
+    STATUS_HOMING
+} SystemStatus;
+
+extern SystemStatus system_status;
+extern uint8_t emergency_stop_flag;
+
+// 位置状态
+extern float current_height;
+extern float current_angle;
+
+// 传感器数据（最近一次读数）
+extern float temperature;
+extern uint8 temperature_valid;
+extern float distance_upper1;
+extern float distance_upper2;
+extern float distance_lower1;
+extern float distance_lower2;
+extern uint8 distance_valid;        // bit0..3 = upper1, upper2, lower1, lower2
+extern uint32 ambient_lux_x10[4];   // 各距离传感器处的环境光，0.1lux
+extern uint8 ambient_lux_valid;     // bit0..3 同 distance_valid
+extern float capacitance;           // pF，滤波后
+extern uint8 capacitance_valid;
+
+// ============ 输出接口 ============
+void uart_send_response(const char* response);
+const char* system_status_string(void);
+
+#endif /* CDC_SYSTEM_H */
+
+/* [] END OF FILE */
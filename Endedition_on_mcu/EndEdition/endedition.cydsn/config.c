@@ -0,0 +1,225 @@
+/*
+ * config.c - 运行参数的RAM副本与保存
+ */
+
+#include <string.h>
+#include "config.h"
+#include "nvstore.h"
+#include "onewire.h"
+#include "timebase.h"
+
+// 记录头8字节，其余为参数值，为以后追加的参数留出空间
+#define CONFIG_RECORD_FIELDS    ((NVSTORE_CONFIG_SIZE - 8u) / sizeof(int32))
+
+typedef struct {
+    const char* name;
+    int32 def;
+    int32 min;
+    int32 max;
+    uint8 decimals;
+} ConfigParam;
+
+typedef struct {
+    uint16 magic;
+    uint8 version;
+    uint8 count;                                    // 保存时的参数个数
+    uint8 crc;                                      // values[0..count) 的CRC-8
+    uint8 reserved[3];
+    int32 values[CONFIG_RECORD_FIELDS];
+} ConfigRecord;
+
+// 按参数编号排列
+static const ConfigParam params[CFG_COUNT] = {
+    { "STEPS_PER_MM",         100,      1,  10000, 0 },
+    { "STEP_DELAY",             1,      1,    100, 0 },
+    { "MIN_HEIGHT",             0, -50000,  50000, 2 },
+    { "MAX_HEIGHT",         20000, -50000,  50000, 2 },
+    { "MIN_ANGLE",          -9000,  -9000,   9000, 2 },
+    { "MAX_ANGLE",           9000,  -9000,   9000, 2 },
+    { "SERVO_MIN_PULSE",      500,    100,   3000, 0 },
+    { "SERVO_MAX_PULSE",     2500,    100,   3000, 0 },
+    { "SERVO_CENTER",        1500,    100,   3000, 0 },
+    { "SERVO_SETTLE_MS",     1000,      0,  10000, 0 },
+    { "HOMING_SPEED_DELAY",     1,      1,    100, 0 },
+    { "HOMING_TIMEOUT",     30000,   1000, 600000, 0 },
+    { "HOMING_BACKOFF_STEPS", 500,      0, 100000, 0 },
+    { "HOMING_BACKOFF_DELAY",   2,      1,    100, 0 },
+    { "HOMING_SETTLE_MS",     100,      0,  10000, 0 },
+    { "HOMING_FINE_STEPS",     20,      1,  10000, 0 },
+    { "HOMING_FINE_DELAY",     10,      1,    100, 0 },
+    { "HOMING_FINE_MAX_STEPS", 100,     1,  10000, 0 }
+};
+
+// ============ 模块状态 ============
+static int32 values[CFG_COUNT];
+static uint8 source = CONFIG_SOURCE_DEFAULTS;
+static uint8 modified = 0;                          // 有未保存的修改
+static uint32 load_us = 0;
+
+// ============ 内部函数 ============
+// 相关参数之间的约束，单个参数的范围检查之外
+static uint8 consistent(const int32* v) {
+    return v[CFG_MIN_HEIGHT] < v[CFG_MAX_HEIGHT] &&
+           v[CFG_MIN_ANGLE] < v[CFG_MAX_ANGLE] &&
+           v[CFG_SERVO_MIN_PULSE] < v[CFG_SERVO_CENTER] &&
+           v[CFG_SERVO_CENTER] < v[CFG_SERVO_MAX_PULSE] &&
+           v[CFG_HOMING_FINE_STEPS] <= v[CFG_HOMING_FINE_MAX_STEPS];
+}
+
+static uint8 in_range(uint8 id, int32 value) {
+    return value >= params[id].min && value <= params[id].max;
+}
+
+// 把旧版本记录换算为当前版本，逐版本升级：
+// 例如版本2改变某参数单位时增加 case 1，换算该值后令 version = 2 继续向下执行
+static uint8 migrate(ConfigRecord* record) {
+    switch(record->version) {
+        case CONFIG_VERSION:
+            return CONFIG_OK;
+        default:
+            return CONFIG_ERR_EMPTY;
+    }
+}
+
+static uint8 load_record(void) {
+    ConfigRecord record;
+    int32 loaded[CFG_COUNT];
+    uint8 stored_version;
+    uint8 count;
+    uint8 i;
+
+    if(nvstore_read(NVSTORE_CONFIG_ADDR, &record, sizeof(record)) != NVSTORE_OK) {
+        return CONFIG_ERR_STORE;
+    }
+    if(record.magic != CONFIG_MAGIC || record.count == 0 || record.count > CONFIG_RECORD_FIELDS) {
+        return CONFIG_ERR_EMPTY;
+    }
+    if(onewire_crc8((const uint8*)record.values, record.count * sizeof(int32)) != record.crc) {
+        return CONFIG_ERR_CRC;
+    }
+    stored_version = record.version;
+    if(migrate(&record) != CONFIG_OK) {
+        return CONFIG_ERR_EMPTY;
+    }
+
+    // 较新固件保存的多余参数忽略，较旧记录缺少的参数保持默认值
+    count = (record.count < CFG_COUNT) ? record.count : CFG_COUNT;
+    memcpy(loaded, values, sizeof(loaded));
+    for(i = 0; i < count; i++) {
+        if(!in_range(i, record.values[i])) {
+            return CONFIG_ERR_RANGE;
+        }
+        loaded[i] = record.values[i];
+    }
+    if(!consistent(loaded)) {
+        return CONFIG_ERR_RANGE;
+    }
+
+    memcpy(values, loaded, sizeof(values));
+    source = (stored_version != CONFIG_VERSION || record.count < CFG_COUNT) ?
+             CONFIG_SOURCE_MIGRATED : CONFIG_SOURCE_SAVED;
+    return CONFIG_OK;
+}
+
+// ============ 对外接口 ============
+void config_defaults(void) {
+    uint8 i;
+
+    for(i = 0; i < CFG_COUNT; i++) {
+        values[i] = params[i].def;
+    }
+    source = CONFIG_SOURCE_DEFAULTS;
+    modified = 0;
+}
+
+// 启动时在使用参数的初始化之前调用一次（nvstore_init 之后），失败时保持默认值
+uint8 config_load(void) {
+    uint32 start_us = timebase_us();
+    uint8 result;
+
+    config_defaults();
+    result = load_record();
+    load_us = timebase_us() - start_us;
+    return result;
+}
+
+// 写闪存行，耗时数十毫秒
+uint8 config_save(void) {
+    ConfigRecord record;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = CONFIG_MAGIC;
+    record.version = CONFIG_VERSION;
+    record.count = CFG_COUNT;
+    memcpy(record.values, values, sizeof(values));
+    record.crc = onewire_crc8((const uint8*)record.values, sizeof(values));
+
+    if(nvstore_write(NVSTORE_CONFIG_ADDR, &record, sizeof(record)) != NVSTORE_OK) {
+        return CONFIG_ERR_STORE;
+    }
+    source = CONFIG_SOURCE_SAVED;
+    modified = 0;
+    return CONFIG_OK;
+}
+
+uint8 config_source(void) {
+    return source;
+}
+
+uint8 config_modified(void) {
+    return modified;
+}
+
+// 上次 config_load() 的耗时，us
+uint32 config_load_us(void) {
+    return load_us;
+}
+
+int32 config_get(uint8 id) {
+    return (id < CFG_COUNT) ? values[id] : 0;
+}
+
+// 只改RAM副本；不满足范围或相关参数的约束时不修改
+uint8 config_set(uint8 id, int32 value) {
+    int32 old;
+
+    if(id >= CFG_COUNT) {
+        return CONFIG_ERR_ID;
+    }
+    if(!in_range(id, value)) {
+        return CONFIG_ERR_RANGE;
+    }
+    old = values[id];
+    values[id] = value;
+    if(!consistent(values)) {
+        values[id] = old;
+        return CONFIG_ERR_RANGE;
+    }
+    if(value != old) {
+        modified = 1;
+    }
+    return CONFIG_OK;
+}
+
+// 按名称查找参数编号，找不到返回 CFG_INVALID
+uint8 config_find(const char* name) {
+    uint8 i;
+
+    for(i = 0; i < CFG_COUNT; i++) {
+        if(strcmp(params[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return CFG_INVALID;
+}
+
+const char* config_name(uint8 id) {
+    return (id < CFG_COUNT) ? params[id].name : "";
+}
+
+// 参数值按 10^decimals 放大保存
+uint8 config_decimals(uint8 id) {
+    return (id < CFG_COUNT) ? params[id].decimals : 0;
+}
+
+/* [] END OF FILE */
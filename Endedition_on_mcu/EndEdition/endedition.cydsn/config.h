@@ -0,0 +1,72 @@
+/*
+ * config.h - 运行参数（步进、高度/角度范围、舵机脉宽、回零）的RAM副本与保存
+ *
+ * 每个参数是一个int32，按编号存放；名称、默认值、范围和小数位数见 config.c 的参数表。
+ * 启动时从 nvstore 载入一次（带版本和CRC-8），之后运行中只读RAM副本：
+ *   - CFG_SET 修改RAM中的值，立即生效，CFG_SAVE 写入闪存后重启仍有效
+ *   - 没有保存过、CRC错误或某个值越界时，使用编译时的默认值
+ * 记录格式迁移：
+ *   - 新参数只追加在编号末尾，旧记录缺少的参数取默认值（不需要改版本号）
+ *   - 已有参数的单位或含义改变时增加 CONFIG_VERSION，在 config.c 的 migrate() 中换算旧值
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "project.h"
+
+#define CONFIG_MAGIC            0xCF60u
+#define CONFIG_VERSION          1u
+
+// 参数编号（只能在末尾追加，编号即保存记录中的位置）
+#define CFG_STEPS_PER_MM        0
+#define CFG_STEP_DELAY          1       // 移动时半个步进周期，ms
+#define CFG_MIN_HEIGHT          2       // 0.01mm
+#define CFG_MAX_HEIGHT          3
+#define CFG_MIN_ANGLE           4       // 0.01°
+#define CFG_MAX_ANGLE           5
+#define CFG_SERVO_MIN_PULSE     6       // -90°的脉宽，us
+#define CFG_SERVO_MAX_PULSE     7       // +90°的脉宽
+#define CFG_SERVO_CENTER        8       // 0°的脉宽
+#define CFG_SERVO_SETTLE_MS     9       // 等待舵机到位
+#define CFG_HOMING_SPEED_DELAY  10      // 寻找限位开关时半个步进周期，ms
+#define CFG_HOMING_TIMEOUT      11      // 寻找限位开关的最长时间，ms
+#define CFG_HOMING_BACKOFF_STEPS 12      // 起始时已在限位开关上，最多后退的步数
+#define CFG_HOMING_BACKOFF_DELAY 13
+#define CFG_HOMING_SETTLE_MS    14
+#define CFG_HOMING_FINE_STEPS   15      // 精确定位：后退步数
+#define CFG_HOMING_FINE_DELAY   16
+#define CFG_HOMING_FINE_MAX_STEPS 17     // 精确定位：回到触发点的最多步数
+#define CFG_COUNT               18
+
+#define CFG_INVALID             0xFF
+
+// 参数来源（config_source）
+#define CONFIG_SOURCE_DEFAULTS  0       // 没有可用的保存记录
+#define CONFIG_SOURCE_SAVED     1
+#define CONFIG_SOURCE_MIGRATED  2       // 旧版本或参数较少的记录，已换算/补齐，建议重新保存
+
+// 返回值
+#define CONFIG_OK               0
+#define CONFIG_ERR_EMPTY        1       // 没有保存过或版本无法迁移
+#define CONFIG_ERR_CRC          2
+#define CONFIG_ERR_STORE        3
+#define CONFIG_ERR_RANGE        4       // 值超出参数范围，或与相关参数矛盾（最小值不小于最大值等）
+#define CONFIG_ERR_ID           5
+
+uint8 config_load(void);
+uint8 config_save(void);
+void config_defaults(void);
+uint8 config_source(void);
+uint8 config_modified(void);
+uint32 config_load_us(void);
+
+int32 config_get(uint8 id);
+uint8 config_set(uint8 id, int32 value);
+uint8 config_find(const char* name);
+const char* config_name(uint8 id);
+uint8 config_decimals(uint8 id);
+
+#endif /* CONFIG_H */
+
+/* [] END OF FILE */
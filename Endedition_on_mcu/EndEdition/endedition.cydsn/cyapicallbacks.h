@@ -16,6 +16,14 @@
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
 
+    /* I2C_Distance: i2c_bus.c drives its transaction queue from the SCB interrupt */
+    #define I2C_Distance_I2C_ISR_EXIT_CALLBACK
+    void I2C_Distance_I2C_ISR_ExitCallback(void);
+
+    /* UART: main.c wakes the command task from the SCB interrupt */
+    #define UART_SPI_UART_ISR_EXIT_CALLBACK
+    void UART_SPI_UART_ISR_ExitCallback(void);
+
     
 #endif /* CYAPICALLBACKS_H */   
 /* [] */
@@ -0,0 +1,52 @@
+/*
+ * dist_calib.c - VL6180X偏移/串扰校准值的保存与载入
+ */
+
+#include "dist_calib.h"
+#include "nvstore.h"
+#include "onewire.h"
+#include "vl6180x.h"
+
+typedef struct {
+    uint16 magic;
+    uint8 version;
+    uint8 crc;                                      // channels 的CRC-8
+    Vl6180xCalibration channels[VL6180X_CHANNELS];
+} DistCalibRecord;
+
+uint8 dist_calib_load(void) {
+    DistCalibRecord record;
+    uint8 ch;
+    
+    if(nvstore_read(NVSTORE_DIST_CALIB_ADDR, &record, sizeof(record)) != NVSTORE_OK) {
+        return DIST_CALIB_ERR_STORE;
+    }
+    if(record.magic != DIST_CALIB_MAGIC || record.version != DIST_CALIB_VERSION) {
+        return DIST_CALIB_ERR_EMPTY;
+    }
+    if(onewire_crc8((const uint8*)record.channels, sizeof(record.channels)) != record.crc) {
+        return DIST_CALIB_ERR_CRC;
+    }
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        vl6180x_set_calibration(ch, &record.channels[ch]);
+    }
+    return DIST_CALIB_OK;
+}
+
+uint8 dist_calib_save(void) {
+    DistCalibRecord record;
+    uint8 ch;
+    
+    record.magic = DIST_CALIB_MAGIC;
+    record.version = DIST_CALIB_VERSION;
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        record.channels[ch] = *vl6180x_calibration(ch);
+    }
+    record.crc = onewire_crc8((const uint8*)record.channels, sizeof(record.channels));
+    
+    return (nvstore_write(NVSTORE_DIST_CALIB_ADDR, &record, sizeof(record)) == NVSTORE_OK) ?
+           DIST_CALIB_OK : DIST_CALIB_ERR_STORE;
+}
+
+/* [] END OF FILE */
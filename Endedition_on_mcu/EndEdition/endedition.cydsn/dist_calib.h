@@ -0,0 +1,25 @@
+/*
+ * dist_calib.h - VL6180X偏移/串扰校准值的保存与载入
+ * 启动时在 vl6180x_init() 之前载入，校准命令完成后保存
+ */
+
+#ifndef DIST_CALIB_H
+#define DIST_CALIB_H
+
+#include "project.h"
+
+#define DIST_CALIB_MAGIC        0xD15Cu
+#define DIST_CALIB_VERSION      1u
+
+// 返回值
+#define DIST_CALIB_OK           0
+#define DIST_CALIB_ERR_EMPTY    1       // 没有保存过或版本不符
+#define DIST_CALIB_ERR_CRC      2
+#define DIST_CALIB_ERR_STORE    3
+
+uint8 dist_calib_load(void);
+uint8 dist_calib_save(void);
+
+#endif /* DIST_CALIB_H */
+
+/* [] END OF FILE */
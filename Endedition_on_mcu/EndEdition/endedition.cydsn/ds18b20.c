@@ -0,0 +1,395 @@
+/*
+ * ds18b20.c - DS18B20温度传感器（多传感器、非阻塞转换）
+ */
+
+#include "ds18b20.h"
+#include "timebase.h"
+#include "log.h"
+#include <string.h>
+
+typedef enum {
+    DS18B20_STATE_IDLE,
+    DS18B20_STATE_START_CONVERT,    // 广播 Convert T 事务进行中
+    DS18B20_STATE_CONVERTING,       // 等待下一次完成查询
+    DS18B20_STATE_BUSY_POLL,        // 读时隙查询进行中
+    DS18B20_STATE_READ              // 读第 read_index 个传感器的暂存器
+} Ds18b20State;
+
+typedef struct {
+    uint8 rom[ONEWIRE_ROM_SIZE];
+    uint8 valid;
+    uint8 resolution;
+    uint8 th;               // 报警上限/下限寄存器，写配置时原样写回
+    uint8 tl;
+    int16 raw;
+    uint32 time_ms;
+    Ds18b20Stats stats;
+} Ds18b20Sensor;
+
+// 暂存器：温度LSB/MSB、TH、TL、配置、保留x3、CRC
+#define SCRATCHPAD_CONFIG       4
+#define CONFIG_RES_SHIFT        5
+#define CONFIG_RESERVED_BITS    0x1Fu
+
+// ============ 模块状态 ============
+static Ds18b20State state = DS18B20_STATE_IDLE;
+static uint32 deadline_ms = 0;        // 下一次开始转换的时刻
+static uint32 convert_done_ms = 0;    // 本次转换的超时上限
+static uint32 busy_poll_ms = 0;       // 下一次完成查询的时刻
+static uint8 read_index = 0;
+static uint8 read_retry = 0;
+static uint32 bus_errors = 0;         // 广播转换时无存在脉冲
+static uint16 idle_ms = DS18B20_IDLE_MS;
+
+static Ds18b20Sensor sensors[DS18B20_MAX_SENSORS];
+static uint8 sensor_count = 0;
+
+// ============ 1-Wire事务 ============
+// 广播转换，总线上所有传感器同时开始
+static uint8 begin_convert_all(void) {
+    static const uint8 cmd[2] = { ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_CONVERT_T };
+    return onewire_begin(ONEWIRE_TXN_RESET, cmd, sizeof(cmd), 0);
+}
+
+static uint8 begin_read_scratchpad(const uint8* rom) {
+    uint8 cmd[ONEWIRE_ROM_SIZE + 2];
+    
+    cmd[0] = ONEWIRE_CMD_MATCH_ROM;
+    memcpy(&cmd[1], rom, ONEWIRE_ROM_SIZE);
+    cmd[ONEWIRE_ROM_SIZE + 1] = DS18B20_CMD_READ_SCRATCHPAD;
+    return onewire_begin(ONEWIRE_TXN_RESET, cmd, sizeof(cmd), DS18B20_SCRATCHPAD_SIZE);
+}
+
+// 转换期间的单个读时隙：0 = 仍在转换，1 = 全部完成（线与）
+static uint8 begin_busy_poll(void) {
+    return onewire_begin_bits(0, NULL, 0, 1);
+}
+
+// 等待阻塞式事务完成（超时由 onewire_wait() 中止事务）
+static uint8 wait_result(void) {
+    return onewire_wait();
+}
+
+// 所有传感器中最长的转换时间，作为广播转换的超时上限
+static uint16 max_conversion_time_ms(void) {
+    uint8 max_res = DS18B20_RES_MIN;
+    uint8 i;
+    
+    for(i = 0; i < sensor_count; i++) {
+        if(sensors[i].resolution > max_res) {
+            max_res = sensors[i].resolution;
+        }
+    }
+    return ds18b20_conversion_time_ms(max_res);
+}
+
+// 全0能通过CRC（总线被拉低），需单独排除；全1（无设备应答）CRC不会通过
+static uint8 scratchpad_valid(const uint8* rx) {
+    uint8 i;
+    
+    for(i = 0; i < DS18B20_SCRATCHPAD_SIZE; i++) {
+        if(rx[i] != 0x00) {
+            return onewire_crc8(rx, DS18B20_SCRATCHPAD_SIZE) == 0;
+        }
+    }
+    return 0;
+}
+
+static void store_scratchpad(Ds18b20Sensor* sensor, const uint8* rx, uint32 now) {
+    uint8 resolution = (uint8)(((rx[SCRATCHPAD_CONFIG] >> CONFIG_RES_SHIFT) & 0x03u) + DS18B20_RES_MIN);
+    uint16 raw = ((uint16)rx[1] << 8) | rx[0];
+    
+    // 低分辨率时最低几位无定义，清零
+    raw &= (uint16)~((1u << (DS18B20_RES_MAX - resolution)) - 1u);
+    
+    sensor->raw = (int16)raw;
+    sensor->th = rx[2];
+    sensor->tl = rx[3];
+    sensor->resolution = resolution;
+    sensor->time_ms = now;
+    sensor->valid = 1;
+}
+
+// ============ 对外接口 ============
+void ds18b20_init(void) {
+    onewire_init();
+    ds18b20_search();
+}
+
+// 重新枚举总线（阻塞，约十几ms/设备），返回找到的DS18B20数量
+uint8 ds18b20_search(void) {
+    uint8 roms[DS18B20_MAX_SENSORS][ONEWIRE_ROM_SIZE];
+    uint8 found = 0;
+    uint8 attempt;
+    uint8 i;
+    
+    // 等待进行中的事务结束，再从头开始状态机
+    onewire_wait();
+    
+    memset(sensors, 0, sizeof(sensors));
+    sensor_count = 0;
+    
+    // 任一ROM码CRC错误说明搜索过程受干扰，整体重新搜索
+    for(attempt = 0; attempt <= DS18B20_SEARCH_RETRIES; attempt++) {
+        found = onewire_search(roms, DS18B20_MAX_SENSORS);
+        for(i = 0; i < found; i++) {
+            if(onewire_crc8(roms[i], ONEWIRE_ROM_SIZE) != 0) {
+                break;
+            }
+        }
+        if(i == found) {
+            break;
+        }
+        LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_TEMP_CRC_ERROR, 0xFF);
+        found = i;  // 重试耗尽时只保留CRC正确的部分
+    }
+    
+    for(i = 0; i < found; i++) {
+        if(roms[i][0] != DS18B20_FAMILY_CODE) {
+            continue;   // 总线上的其他1-Wire器件
+        }
+        memcpy(sensors[sensor_count].rom, roms[i], ONEWIRE_ROM_SIZE);
+        sensors[sensor_count].resolution = DS18B20_RES_DEFAULT;   // 首次读暂存器后更新
+        sensor_count++;
+    }
+    
+    LOG_INFO(LOG_CAT_SENSOR, LOG_EVT_TEMP_SEARCH, sensor_count);
+    
+    state = DS18B20_STATE_IDLE;
+    deadline_ms = timebase_ms();
+    
+    return sensor_count;
+}
+
+// 推进状态机，一轮读数全部完成时返回1
+// 总线时序由 onewire 中断完成，这里只检查事务是否结束
+uint8 ds18b20_poll(void) {
+    uint32 now = timebase_ms();
+    uint8 rx[DS18B20_SCRATCHPAD_SIZE];
+    uint8 status;
+    Ds18b20Sensor* sensor;
+    
+    switch(state) {
+        case DS18B20_STATE_IDLE:
+            if(!TIMEBASE_EXPIRED(now, deadline_ms)) {
+                return 0;
+            }
+            if(sensor_count == 0) {
+                LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_TEMP_NO_DEVICE, 0);
+                deadline_ms = now + DS18B20_NO_SENSOR_RETRY_MS;
+                return 0;
+            }
+            if(begin_convert_all() == ONEWIRE_OK) {
+                state = DS18B20_STATE_START_CONVERT;
+            }
+            return 0;
+            
+        case DS18B20_STATE_START_CONVERT:
+            if(onewire_busy()) {
+                return 0;
+            }
+            if(onewire_result(NULL) != ONEWIRE_OK) {
+                bus_errors++;
+                LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_TEMP_NO_DEVICE, 0);
+                state = DS18B20_STATE_IDLE;
+                deadline_ms = now + idle_ms;
+                return 0;
+            }
+            convert_done_ms = now + max_conversion_time_ms();
+            busy_poll_ms = now + DS18B20_BUSY_POLL_MS;
+            state = DS18B20_STATE_CONVERTING;
+            return 0;
+            
+        case DS18B20_STATE_CONVERTING:
+            if(TIMEBASE_EXPIRED(now, convert_done_ms)) {
+                break;  // 超时上限已到，直接读取
+            }
+            if(TIMEBASE_EXPIRED(now, busy_poll_ms) && begin_busy_poll() == ONEWIRE_OK) {
+                state = DS18B20_STATE_BUSY_POLL;
+            }
+            return 0;
+            
+        case DS18B20_STATE_BUSY_POLL:
+            if(onewire_busy()) {
+                return 0;
+            }
+            if(onewire_result(rx) != ONEWIRE_OK || (rx[0] & 0x01u) == 0) {
+                busy_poll_ms = now + DS18B20_BUSY_POLL_MS;
+                state = DS18B20_STATE_CONVERTING;
+                return 0;
+            }
+            break;  // 全部传感器转换完成
+            
+        case DS18B20_STATE_READ:
+            if(onewire_busy()) {
+                return 0;
+            }
+            sensor = &sensors[read_index];
+            status = onewire_result(rx);
+            if(status == ONEWIRE_OK && scratchpad_valid(rx)) {
+                store_scratchpad(sensor, rx, now);
+                sensor->stats.reads_ok++;
+                LOG_DEBUG(LOG_CAT_SENSOR, LOG_EVT_TEMP_READ, ((int32)read_index << 16) | (uint16)sensor->raw);
+            } else {
+                if(status == ONEWIRE_OK) {
+                    sensor->stats.crc_errors++;
+                    LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_TEMP_CRC_ERROR, read_index);
+                } else {
+                    sensor->stats.no_response++;
+                    LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_TEMP_NO_DEVICE, read_index + 1);
+                }
+                
+                if(read_retry < DS18B20_READ_RETRIES &&
+                   begin_read_scratchpad(sensor->rom) == ONEWIRE_OK) {
+                    read_retry++;
+                    sensor->stats.retries++;
+                    return 0;
+                }
+                // 重试耗尽，作废旧读数，避免上报过期或错误的温度
+                sensor->valid = 0;
+                sensor->stats.failed_rounds++;
+            }
+            
+            read_retry = 0;
+            read_index++;
+            if(read_index < sensor_count &&
+               begin_read_scratchpad(sensors[read_index].rom) == ONEWIRE_OK) {
+                return 0;
+            }
+            // 一轮结束后短暂空闲再开始下一次转换，更新速率随分辨率提高
+            state = DS18B20_STATE_IDLE;
+            deadline_ms = now + idle_ms;
+            return 1;
+            
+        default:
+            state = DS18B20_STATE_IDLE;
+            return 0;
+    }
+    
+    // 转换完成，开始逐个读取
+    read_index = 0;
+    read_retry = 0;
+    if(begin_read_scratchpad(sensors[0].rom) == ONEWIRE_OK) {
+        state = DS18B20_STATE_READ;
+    }
+    return 0;
+}
+
+// 写配置寄存器并保存到EEPROM（阻塞约15ms），当前一轮转换作废重新开始。
+// Write Scratchpad 必须同时写TH/TL，先读一次暂存器取得传感器中保存的报警值，
+// 避免刚启动或重新搜索后（尚无读数）把EEPROM中的TH/TL覆盖为0
+uint8 ds18b20_set_resolution(uint8 index, uint8 bits) {
+    uint8 cmd[ONEWIRE_ROM_SIZE + 5];
+    uint8 rx[DS18B20_SCRATCHPAD_SIZE];
+    Ds18b20Sensor* sensor;
+    uint32 copy_done;
+    
+    if(index >= sensor_count) {
+        return DS18B20_ERR_INDEX;
+    }
+    if(bits < DS18B20_RES_MIN || bits > DS18B20_RES_MAX) {
+        return DS18B20_ERR_RESOLUTION;
+    }
+    sensor = &sensors[index];
+    
+    // 下面的阻塞事务取代了状态机进行中的事务，无论成败都从新一轮转换开始
+    onewire_wait();
+    state = DS18B20_STATE_IDLE;
+    deadline_ms = timebase_ms();
+    
+    if(begin_read_scratchpad(sensor->rom) != ONEWIRE_OK || wait_result() != ONEWIRE_OK) {
+        return DS18B20_ERR_BUS;
+    }
+    onewire_result(rx);
+    if(!scratchpad_valid(rx)) {
+        return DS18B20_ERR_BUS;
+    }
+    sensor->th = rx[2];
+    sensor->tl = rx[3];
+    
+    cmd[0] = ONEWIRE_CMD_MATCH_ROM;
+    memcpy(&cmd[1], sensor->rom, ONEWIRE_ROM_SIZE);
+    cmd[ONEWIRE_ROM_SIZE + 1] = DS18B20_CMD_WRITE_SCRATCHPAD;
+    cmd[ONEWIRE_ROM_SIZE + 2] = sensor->th;
+    cmd[ONEWIRE_ROM_SIZE + 3] = sensor->tl;
+    cmd[ONEWIRE_ROM_SIZE + 4] = (uint8)(((bits - DS18B20_RES_MIN) << CONFIG_RES_SHIFT) | CONFIG_RESERVED_BITS);
+    if(onewire_begin(ONEWIRE_TXN_RESET, cmd, sizeof(cmd), 0) != ONEWIRE_OK ||
+       wait_result() != ONEWIRE_OK) {
+        return DS18B20_ERR_BUS;
+    }
+    
+    cmd[ONEWIRE_ROM_SIZE + 1] = DS18B20_CMD_COPY_SCRATCHPAD;
+    if(onewire_begin(ONEWIRE_TXN_RESET, cmd, ONEWIRE_ROM_SIZE + 2, 0) != ONEWIRE_OK ||
+       wait_result() != ONEWIRE_OK) {
+        return DS18B20_ERR_BUS;
+    }
+    
+    copy_done = timebase_ms() + DS18B20_COPY_TIME_MS;
+    while(!TIMEBASE_EXPIRED(timebase_ms(), copy_done)) {
+    }
+    
+    sensor->resolution = bits;
+    LOG_INFO(LOG_CAT_SENSOR, LOG_EVT_TEMP_RESOLUTION, ((int32)index << 8) | bits);
+    
+    deadline_ms = timebase_ms();
+    
+    return DS18B20_OK;
+}
+
+uint8 ds18b20_resolution(uint8 index) {
+    return (index < sensor_count) ? sensors[index].resolution : 0;
+}
+
+// 9/10/11/12位：93.75/187.5/375/750ms（向上取整）
+uint16 ds18b20_conversion_time_ms(uint8 bits) {
+    if(bits < DS18B20_RES_MIN) {
+        bits = DS18B20_RES_MIN;
+    } else if(bits > DS18B20_RES_MAX) {
+        bits = DS18B20_RES_MAX;
+    }
+    return (uint16)((750u >> (DS18B20_RES_MAX - bits)) + 1u);
+}
+
+// 一轮读取结束到下一次转换的间隔，下一轮开始生效
+void ds18b20_set_interval(uint16 interval_ms) {
+    idle_ms = (interval_ms < DS18B20_IDLE_MS_MAX) ? interval_ms : DS18B20_IDLE_MS_MAX;
+}
+
+uint16 ds18b20_interval(void) {
+    return idle_ms;
+}
+
+uint8 ds18b20_count(void) {
+    return sensor_count;
+}
+
+const uint8* ds18b20_rom(uint8 index) {
+    return (index < sensor_count) ? sensors[index].rom : NULL;
+}
+
+uint8 ds18b20_has_reading(uint8 index) {
+    return (index < sensor_count) ? sensors[index].valid : 0;
+}
+
+int16 ds18b20_raw(uint8 index) {
+    return (index < sensor_count) ? sensors[index].raw : 0;
+}
+
+// 原始值统一按12位格式，LSB = 0.0625°C
+float ds18b20_celsius(uint8 index) {
+    return (float)ds18b20_raw(index) * 0.0625f;
+}
+
+uint32 ds18b20_timestamp_ms(uint8 index) {
+    return (index < sensor_count) ? sensors[index].time_ms : 0;
+}
+
+const Ds18b20Stats* ds18b20_stats(uint8 index) {
+    return (index < sensor_count) ? &sensors[index].stats : NULL;
+}
+
+uint32 ds18b20_bus_errors(void) {
+    return bus_errors;
+}
+
+/* [] END OF FILE */
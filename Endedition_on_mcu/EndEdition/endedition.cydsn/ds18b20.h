@@ -0,0 +1,80 @@
+/*
+ * ds18b20.h - DS18B20温度传感器（多传感器、非阻塞转换）
+ *
+ * 上电时用 Search ROM 枚举总线上的DS18B20并记录ROM码。
+ * 每个采样周期广播一次 Convert T（Skip ROM），所有传感器同时转换，
+ * 转换期间用读时隙查询完成状态（转换中读到0，完成后读到1），
+ * 完成后用 Match ROM 逐个读取暂存器，N个传感器只需一次转换时间。
+ * 分辨率可按传感器设置（9~12位），转换时间随之缩短，超时上限按最高分辨率计算。
+ * 读时隙查询要求传感器外部供电（非寄生供电）。
+ * 总线读写通过 onewire 事务在定时器中断中完成，不占用主循环。
+ *
+ * 每次读取完整的9字节暂存器并校验CRC-8；无存在脉冲或CRC错误时有限次重试，
+ * 重试仍失败则该传感器读数作废（GET_TEMPS输出NA），不会把旧值或错误值上报。
+ */
+
+#ifndef DS18B20_H
+#define DS18B20_H
+
+#include "project.h"
+#include "onewire.h"
+
+#define DS18B20_MAX_SENSORS         4       // 腔体、电极、环境 + 备用
+#define DS18B20_FAMILY_CODE         0x28
+
+#define DS18B20_RES_MIN             9
+#define DS18B20_RES_MAX             12
+#define DS18B20_RES_DEFAULT         12      // 上电默认配置
+
+#define DS18B20_BUSY_POLL_MS        10      // 转换完成查询间隔
+#define DS18B20_IDLE_MS             50      // 一轮读取结束到下一次转换开始（默认值）
+#define DS18B20_IDLE_MS_MAX         60000
+#define DS18B20_COPY_TIME_MS        10      // 暂存器写入EEPROM时间
+#define DS18B20_NO_SENSOR_RETRY_MS  1000    // 未找到传感器时的告警间隔
+#define DS18B20_READ_RETRIES        2       // 单个传感器每轮最多重读次数
+#define DS18B20_SEARCH_RETRIES      2       // ROM码CRC错误时重新搜索次数
+#define DS18B20_SCRATCHPAD_SIZE     9
+
+// 功能命令
+#define DS18B20_CMD_CONVERT_T       0x44
+#define DS18B20_CMD_WRITE_SCRATCHPAD 0x4E
+#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+#define DS18B20_CMD_COPY_SCRATCHPAD 0x48
+
+// 返回值
+#define DS18B20_OK                  0
+#define DS18B20_ERR_INDEX           1
+#define DS18B20_ERR_RESOLUTION      2
+#define DS18B20_ERR_BUS             3
+
+// 每个传感器的诊断计数
+typedef struct {
+    uint32 reads_ok;
+    uint32 crc_errors;
+    uint32 no_response;     // 复位后无存在脉冲
+    uint32 retries;
+    uint32 failed_rounds;   // 重试耗尽、读数作废的轮次
+} Ds18b20Stats;
+
+void ds18b20_init(void);
+uint8 ds18b20_search(void);
+uint8 ds18b20_poll(void);
+uint8 ds18b20_set_resolution(uint8 index, uint8 bits);
+uint8 ds18b20_resolution(uint8 index);
+uint16 ds18b20_conversion_time_ms(uint8 bits);
+void ds18b20_set_interval(uint16 idle_ms);
+uint16 ds18b20_interval(void);
+
+uint8 ds18b20_count(void);
+const uint8* ds18b20_rom(uint8 index);
+uint8 ds18b20_has_reading(uint8 index);
+int16 ds18b20_raw(uint8 index);
+float ds18b20_celsius(uint8 index);
+uint32 ds18b20_timestamp_ms(uint8 index);
+
+const Ds18b20Stats* ds18b20_stats(uint8 index);
+uint32 ds18b20_bus_errors(void);
+
+#endif /* DS18B20_H */
+
+/* [] END OF FILE */
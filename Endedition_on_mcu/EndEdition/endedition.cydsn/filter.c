@@ -0,0 +1,199 @@
+/*
+ * filter.c - 传感器数据滤波（每通道：离群剔除 -> 滑动中值 -> 指数平均）
+ */
+
+#include "filter.h"
+
+typedef struct {
+    FilterConfig config;
+    FilterStats stats;
+    int32 ring[FILTER_MAX_WINDOW];      // 按到达顺序
+    int32 sorted[FILTER_MAX_WINDOW];    // 同样的样本，升序
+    uint8 head;                         // 下一个写入位置（窗口满时即最旧的样本）
+    uint8 count;
+    uint8 consecutive_rejects;
+    uint8 since_reject;                 // 上次剔除后接受的样本数（饱和）
+    int32 ema;
+} FilterChannel;
+
+// 默认参数：距离每周期一个样本，平均较强；温度约1秒一个样本，平均较弱
+static const FilterConfig default_config[FILTER_CHANNELS] = {
+    { 5, 8192, 200 },       // 距离：中值5，α=0.25，偏差超过20mm剔除
+    { 5, 8192, 200 },
+    { 5, 8192, 200 },
+    { 5, 8192, 200 },
+    { 3, 16384, 200 },      // 温度：中值3，α=0.5，偏差超过2°C剔除
+    { 5, 8192, 5000 }       // 电容：约160ms一个值，中值5，α=0.25，偏差超过5pF剔除
+};
+
+// ============ 模块状态 ============
+static FilterChannel channels[FILTER_CHANNELS];
+
+// ============ 内部函数 ============
+static void clear_window(FilterChannel* f) {
+    f->head = 0;
+    f->count = 0;
+    f->consecutive_rejects = 0;
+}
+
+static int32 median(const FilterChannel* f) {
+    return f->sorted[f->count / 2];
+}
+
+// 窗口满时用新样本替换最旧的样本，有序副本中删除旧值、插入新值
+static void insert_sample(FilterChannel* f, int32 value) {
+    uint8 i;
+
+    if(f->count == f->config.window) {
+        int32 old = f->ring[f->head];
+
+        for(i = 0; f->sorted[i] != old; i++) {
+        }
+        for(; i + 1 < f->count; i++) {
+            f->sorted[i] = f->sorted[i + 1];
+        }
+        f->count--;
+    }
+
+    f->ring[f->head] = value;
+    if(++f->head >= f->config.window) {
+        f->head = 0;
+    }
+
+    for(i = f->count; i > 0 && f->sorted[i - 1] > value; i--) {
+        f->sorted[i] = f->sorted[i - 1];
+    }
+    f->sorted[i] = value;
+    f->count++;
+}
+
+// ============ 对外接口 ============
+void filter_init(void) {
+    uint8 ch;
+
+    for(ch = 0; ch < FILTER_CHANNELS; ch++) {
+        filter_configure(ch, &default_config[ch]);
+    }
+}
+
+// 修改参数会清空窗口和统计
+uint8 filter_configure(uint8 channel, const FilterConfig* config) {
+    FilterChannel* f;
+
+    if(channel >= FILTER_CHANNELS) {
+        return FILTER_ERR_CHANNEL;
+    }
+    if(config->window == 0 || config->window > FILTER_MAX_WINDOW || (config->window & 1u) == 0) {
+        return FILTER_ERR_WINDOW;
+    }
+    if(config->alpha_q15 == 0 || config->alpha_q15 > FILTER_ALPHA_ONE || config->reject_threshold < 0) {
+        return FILTER_ERR_ALPHA;
+    }
+
+    f = &channels[channel];
+    f->config = *config;
+    f->stats.accepted = 0;
+    f->stats.rejected = 0;
+    f->stats.resets = 0;
+    f->since_reject = 0xFF;
+    clear_window(f);
+
+    return FILTER_OK;
+}
+
+const FilterConfig* filter_config(uint8 channel) {
+    return (channel < FILTER_CHANNELS) ? &channels[channel].config : NULL;
+}
+
+const FilterStats* filter_stats(uint8 channel) {
+    return (channel < FILTER_CHANNELS) ? &channels[channel].stats : NULL;
+}
+
+void filter_reset(uint8 channel) {
+    if(channel < FILTER_CHANNELS) {
+        clear_window(&channels[channel]);
+    }
+}
+
+// 加入一个样本，返回1 = 接受，0 = 作为离群值剔除
+uint8 filter_add(uint8 channel, int32 value) {
+    FilterChannel* f;
+    int32 deviation;
+
+    if(channel >= FILTER_CHANNELS) {
+        return 0;
+    }
+    f = &channels[channel];
+
+    if(f->count == f->config.window && f->config.reject_threshold > 0) {
+        deviation = value - median(f);
+        if(deviation < 0) {
+            deviation = -deviation;
+        }
+        if(deviation > f->config.reject_threshold) {
+            f->since_reject = 0;
+            if(++f->consecutive_rejects < f->config.window) {
+                f->stats.rejected++;
+                return 0;
+            }
+            // 一整个窗口都偏离：测量值已经跳变，从新值重新开始
+            f->stats.resets++;
+            clear_window(f);
+        }
+    }
+    f->consecutive_rejects = 0;
+
+    insert_sample(f, value);
+    if(f->count == 1) {
+        f->ema = value;
+    } else {
+        // 电容以fF为单位，差值乘Q15系数可能超出32位
+        f->ema += (int32)(((int64)(median(f) - f->ema) * f->config.alpha_q15 + 16384) >> 15);
+    }
+
+    f->stats.accepted++;
+    if(f->since_reject < 0xFF) {
+        f->since_reject++;
+    }
+    return 1;
+}
+
+// 传感器报告错误的样本：计入剔除，连续一个窗口后清空通道
+void filter_add_invalid(uint8 channel) {
+    FilterChannel* f;
+
+    if(channel >= FILTER_CHANNELS) {
+        return;
+    }
+    f = &channels[channel];
+
+    f->stats.rejected++;
+    f->since_reject = 0;
+    if(f->count > 0 && ++f->consecutive_rejects >= f->config.window) {
+        f->stats.resets++;
+        clear_window(f);
+    }
+}
+
+uint8 filter_quality(uint8 channel) {
+    const FilterChannel* f;
+
+    if(channel >= FILTER_CHANNELS || channels[channel].count == 0) {
+        return FILTER_QUALITY_NONE;
+    }
+    f = &channels[channel];
+    if(f->since_reject < f->config.window) {
+        return FILTER_QUALITY_NOISY;
+    }
+    if(f->count < f->config.window) {
+        return FILTER_QUALITY_WARMUP;
+    }
+    return FILTER_QUALITY_GOOD;
+}
+
+// 滤波后的值；filter_quality() 为 NONE 时无意义
+int32 filter_value(uint8 channel) {
+    return (channel < FILTER_CHANNELS) ? channels[channel].ema : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,66 @@
+/*
+ * filter.h - 传感器数据滤波（每通道：离群剔除 -> 滑动中值 -> 指数平均）
+ *
+ * 数值是调用者选定单位的整数（距离0.1mm、温度0.01°C、电容fF），全部整数运算：
+ *   1. 窗口填满后，与当前中值相差超过阈值的样本被剔除并计数；
+ *      连续剔除满一个窗口说明测量值真的变了，清空窗口从新值重新开始
+ *   2. 环形缓冲区保存最近 window 个样本，同时维护一份有序副本，
+ *      每个样本只做一次删除和一次插入，O(window)
+ *   3. 中值再经过Q15系数的指数平均（系数32768 = 不平均）
+ * 传感器报告的错误样本用 filter_add_invalid() 计入剔除数，连续一个窗口的
+ * 错误样本后通道清空（不再输出旧值）。
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "project.h"
+
+// 通道分配
+#define FILTER_CH_DIST0             0       // 四路距离（VL6180X通道0..3），0.1mm
+#define FILTER_CH_TEMP              4       // 腔体温度，0.01°C
+#define FILTER_CH_CAP               5       // 电容，fF
+#define FILTER_CHANNELS             6
+
+#define FILTER_MAX_WINDOW           7       // 中值窗口：1（不做中值）、3、5、7
+#define FILTER_ALPHA_ONE            32768u  // Q15的1.0
+
+// 质量标志
+#define FILTER_QUALITY_NONE         0       // 没有数据
+#define FILTER_QUALITY_WARMUP       1       // 窗口未填满
+#define FILTER_QUALITY_GOOD         2
+#define FILTER_QUALITY_NOISY        3       // 最近一个窗口内有样本被剔除
+
+// 返回值
+#define FILTER_OK                   0
+#define FILTER_ERR_CHANNEL          1
+#define FILTER_ERR_WINDOW           2
+#define FILTER_ERR_ALPHA            3
+
+typedef struct {
+    uint8 window;
+    uint16 alpha_q15;           // 1..32768
+    int32 reject_threshold;     // 与中值的最大偏差，0 = 不剔除
+} FilterConfig;
+
+typedef struct {
+    uint32 accepted;
+    uint32 rejected;            // 离群值和错误样本
+    uint16 resets;              // 连续剔除后重新开始的次数
+} FilterStats;
+
+void filter_init(void);
+uint8 filter_configure(uint8 channel, const FilterConfig* config);
+const FilterConfig* filter_config(uint8 channel);
+const FilterStats* filter_stats(uint8 channel);
+void filter_reset(uint8 channel);
+
+uint8 filter_add(uint8 channel, int32 value);
+void filter_add_invalid(uint8 channel);
+
+uint8 filter_quality(uint8 channel);
+int32 filter_value(uint8 channel);
+
+#endif /* FILTER_H */
+
+/* [] END OF FILE */
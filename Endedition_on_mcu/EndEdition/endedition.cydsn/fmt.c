@@ -0,0 +1,139 @@
+/*
+ * fmt.c - 轻量级整数/定点数格式化
+ *
+ * 十进制转换用10的幂次减法完成，M0+上没有硬件除法，
+ * 这样每位最多9次减法，避免调用 __aeabi_uidiv；定点数也不用除法拆分整数和小数部分。
+ */
+
+#include "fmt.h"
+
+static const uint32 pow10_table[] = {
+    1000000000u, 100000000u, 10000000u, 1000000u, 100000u,
+    10000u, 1000u, 100u, 10u, 1u
+};
+
+static const int32 decimal_scale[FMT_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+// 按固定位数输出（不足补0），width为0时去掉前导0
+static uint16 put_digits(char* dst, uint32 value, uint8 width) {
+    uint16 len = 0;
+    uint8 i;
+    uint8 first = (width > 0) ? (uint8)(10 - width) : 0;
+
+    for(i = first; i < 10; i++) {
+        char digit = '0';
+        uint32 p = pow10_table[i];
+
+        while(value >= p) {
+            value -= p;
+            digit++;
+        }
+        if(len > 0 || digit != '0' || width > 0 || i == 9) {
+            dst[len++] = digit;
+        }
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+uint16 fmt_str(char* dst, const char* str) {
+    uint16 len = 0;
+
+    while(str[len] != '\0') {
+        dst[len] = str[len];
+        len++;
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+uint16 fmt_char(char* dst, char c) {
+    dst[0] = c;
+    dst[1] = '\0';
+    return 1;
+}
+
+uint16 fmt_uint(char* dst, uint32 value) {
+    return put_digits(dst, value, 0);
+}
+
+uint16 fmt_int(char* dst, int32 value) {
+    if(value < 0) {
+        dst[0] = '-';
+        return (uint16)(1 + put_digits(dst + 1, (uint32)0 - (uint32)value, 0));
+    }
+    return put_digits(dst, (uint32)value, 0);
+}
+
+uint16 fmt_hex8(char* dst, uint8 value) {
+    dst[0] = '0';
+    dst[1] = 'x';
+    dst[2] = hex_digits[value >> 4];
+    dst[3] = hex_digits[value & 0x0F];
+    dst[4] = '\0';
+    return 4;
+}
+
+// value为放大10^decimals倍后的定点数，例如 fmt_fixed(p, -5, 1) -> "-0.5"
+uint16 fmt_fixed(char* dst, int32 value, uint8 decimals) {
+    uint16 len = 0;
+    uint16 digits;
+    uint32 magnitude;
+    uint8 i;
+
+    if(decimals > FMT_MAX_DECIMALS) {
+        decimals = FMT_MAX_DECIMALS;
+    }
+
+    if(value < 0) {
+        dst[len++] = '-';
+        magnitude = (uint32)0 - (uint32)value;
+    } else {
+        magnitude = (uint32)value;
+    }
+
+    // 不做除法拆分：整个定点数按位输出（至少 decimals+1 位，整数部分为0时补0），
+    // 再把最后 decimals 位后移一位插入小数点
+    digits = put_digits(dst + len, magnitude, 0);
+    if(digits <= decimals) {
+        digits = put_digits(dst + len, magnitude, (uint8)(decimals + 1));
+    }
+    len += digits;
+
+    if(decimals > 0) {
+        for(i = 0; i < decimals; i++) {
+            dst[len - i] = dst[len - i - 1];
+        }
+        dst[len - decimals] = '.';
+        len++;
+    }
+
+    dst[len] = '\0';
+    return len;
+}
+
+uint16 fmt_float(char* dst, float value, uint8 decimals) {
+    float scaled;
+
+    if(decimals > FMT_MAX_DECIMALS) {
+        decimals = FMT_MAX_DECIMALS;
+    }
+
+    // 四舍五入到定点数，超出int32范围时饱和
+    scaled = value * (float)decimal_scale[decimals];
+    scaled += (scaled >= 0.0f) ? 0.5f : -0.5f;
+
+    if(scaled >= 2147483647.0f) {
+        return fmt_fixed(dst, 2147483647, decimals);
+    }
+    if(scaled <= -2147483647.0f) {
+        return fmt_fixed(dst, -2147483647, decimals);
+    }
+    return fmt_fixed(dst, (int32)scaled, decimals);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,28 @@
+/*
+ * fmt.h - 轻量级整数/定点数格式化
+ * 替代 sprintf("%d")/sprintf("%.1f")，不使用堆，不依赖浮点printf
+ *
+ * 所有函数把结果追加写入调用者提供的缓冲区，写入结尾'\0'，
+ * 返回写入的字符数（不含'\0'），可以连续拼接：
+ *     p += fmt_str(p, "STATUS:");
+ *     p += fmt_float(p, current_height, 1);
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include "project.h"
+
+#define FMT_MAX_DECIMALS    4
+
+uint16 fmt_str(char* dst, const char* str);
+uint16 fmt_char(char* dst, char c);
+uint16 fmt_uint(char* dst, uint32 value);
+uint16 fmt_int(char* dst, int32 value);
+uint16 fmt_hex8(char* dst, uint8 value);
+uint16 fmt_fixed(char* dst, int32 value, uint8 decimals);
+uint16 fmt_float(char* dst, float value, uint8 decimals);
+
+#endif /* FMT_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,167 @@
+/*
+ * log.c - 运行时日志级别 + SRAM环形缓冲区延迟输出
+ *
+ * 写入端可以在中断中调用，入队时短暂关中断；
+ * 缓冲区满时覆盖最旧的记录并计数。
+ */
+
+#include "log.h"
+#include "fmt.h"
+#include "timebase.h"
+
+#define LOG_RING_MASK       (LOG_RING_SIZE - 1u)
+
+uint8 log_level = LOG_LEVEL_DEFAULT;
+
+static uint8 log_categories = LOG_CAT_ALL;
+static uint8 log_auto_drain = 0;
+
+static LogRecord log_ring[LOG_RING_SIZE];
+static volatile uint16 log_head = 0;    // 下一个写入位置
+static volatile uint16 log_tail = 0;    // 下一个读出位置
+static volatile uint32 log_dropped_count = 0;
+
+static const char* const log_event_names[LOG_EVT_COUNT] = {
+    "BOOT",
+    "HEARTBEAT",
+    "CMD_RECEIVED",
+    "CMD_UNKNOWN",
+    "CMD_TEST",
+    "EMERGENCY_STOP",
+    "HOMING_START",
+    "HOMING_DONE",
+    "HOMING_FAILED",
+    "MOVE_START",
+    "MOVE_DONE",
+    "MOVE_INTERRUPTED",
+    "DIST_READ_FAILED",
+    "SENSORS_SENT",
+    "STREAM_START",
+    "STREAM_STOP",
+    "BAUD_SWITCH",
+    "BAUD_REVERTED",
+    "TEMP_READ",
+    "TEMP_NO_DEVICE",
+    "TEMP_SEARCH",
+    "TEMP_RESOLUTION",
+    "TEMP_CRC_ERROR",
+    "DIST_INIT_FAILED",
+    "DIST_REINIT",
+    "DIST_CALIB",
+    "CAP_CALIB",
+    "CAP_NO_SIGNAL",
+    "CONFIG"
+};
+
+static const char* const log_level_names[] = {
+    "OFF", "ERROR", "WARN", "INFO", "DEBUG"
+};
+
+// ============ 配置 ============
+void log_init(void) {
+    log_head = 0;
+    log_tail = 0;
+    log_dropped_count = 0;
+}
+
+void log_set_level(uint8 level) {
+    log_level = (level > LOG_LEVEL_DEBUG) ? LOG_LEVEL_DEBUG : level;
+}
+
+uint8 log_get_level(void) {
+    return log_level;
+}
+
+void log_set_categories(uint8 mask) {
+    log_categories = mask;
+}
+
+uint8 log_get_categories(void) {
+    return log_categories;
+}
+
+void log_set_auto_drain(uint8 enable) {
+    log_auto_drain = enable ? 1 : 0;
+}
+
+uint8 log_get_auto_drain(void) {
+    return log_auto_drain;
+}
+
+// ============ 写入与读出 ============
+void log_write(uint8 level, uint8 category, uint8 event, int32 value) {
+    uint8 int_state;
+    LogRecord* record;
+
+    if(level == LOG_LEVEL_OFF || level > log_level || (category & log_categories) == 0) {
+        return;
+    }
+
+    int_state = CyEnterCriticalSection();
+
+    record = &log_ring[log_head];
+    record->timestamp_ms = timebase_ms();
+    record->timestamp_us = timebase_us();
+    record->value = value;
+    record->event = event;
+    record->level = level;
+    record->category = category;
+
+    log_head = (log_head + 1u) & LOG_RING_MASK;
+    if(log_head == log_tail) {
+        // 缓冲区满，丢弃最旧的一条
+        log_tail = (log_tail + 1u) & LOG_RING_MASK;
+        log_dropped_count++;
+    }
+
+    CyExitCriticalSection(int_state);
+}
+
+uint8 log_pop(LogRecord* record) {
+    uint8 int_state;
+    uint8 found = 0;
+
+    int_state = CyEnterCriticalSection();
+    if(log_tail != log_head) {
+        *record = log_ring[log_tail];
+        log_tail = (log_tail + 1u) & LOG_RING_MASK;
+        found = 1;
+    }
+    CyExitCriticalSection(int_state);
+
+    return found;
+}
+
+uint16 log_count(void) {
+    return (uint16)((log_head - log_tail) & LOG_RING_MASK);
+}
+
+uint32 log_dropped(void) {
+    return log_dropped_count;
+}
+
+// 格式: LOG:时间ms,级别,事件,数值,时间us\r\n
+uint16 log_format(char* dst, const LogRecord* record) {
+    char* p = dst;
+
+    p += fmt_str(p, "LOG:");
+    p += fmt_uint(p, record->timestamp_ms);
+    p += fmt_char(p, ',');
+    p += fmt_str(p, log_level_names[(record->level <= LOG_LEVEL_DEBUG) ? record->level : 0]);
+    p += fmt_char(p, ',');
+    if(record->event < LOG_EVT_COUNT) {
+        p += fmt_str(p, log_event_names[record->event]);
+    } else {
+        p += fmt_str(p, "EVT_");
+        p += fmt_uint(p, record->event);
+    }
+    p += fmt_char(p, ',');
+    p += fmt_int(p, record->value);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, record->timestamp_us);
+    p += fmt_str(p, "\r\n");
+
+    return (uint16)(p - dst);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,104 @@
+/*
+ * log.h - 运行时日志级别 + SRAM环形缓冲区延迟输出
+ *
+ * 记录以紧凑的二进制条目写入环形缓冲区（事件号 + 一个数值），
+ * 热路径中不做任何字符串格式化或UART发送。
+ * 链路空闲时逐条输出，或通过 LOG_DUMP 命令一次性读出。
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "project.h"
+
+#define LOG_RING_SIZE       64      // 必须是2的幂
+
+// 日志级别（数值越大越详细）
+#define LOG_LEVEL_OFF       0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+#define LOG_LEVEL_DEFAULT   LOG_LEVEL_INFO
+
+// 日志类别（位掩码）
+#define LOG_CAT_SYSTEM      0x01u
+#define LOG_CAT_CMD         0x02u
+#define LOG_CAT_MOTION      0x04u
+#define LOG_CAT_SENSOR      0x08u
+#define LOG_CAT_COMM        0x10u
+#define LOG_CAT_ALL         0xFFu
+
+// 事件号，名称表见 log.c
+typedef enum {
+    LOG_EVT_BOOT,
+    LOG_EVT_HEARTBEAT,
+    LOG_EVT_CMD_RECEIVED,
+    LOG_EVT_CMD_UNKNOWN,
+    LOG_EVT_CMD_TEST,
+    LOG_EVT_EMERGENCY_STOP,
+    LOG_EVT_HOMING_START,
+    LOG_EVT_HOMING_DONE,
+    LOG_EVT_HOMING_FAILED,
+    LOG_EVT_MOVE_START,
+    LOG_EVT_MOVE_DONE,
+    LOG_EVT_MOVE_INTERRUPTED,
+    LOG_EVT_DIST_READ_FAILED,
+    LOG_EVT_SENSORS_SENT,
+    LOG_EVT_STREAM_START,
+    LOG_EVT_STREAM_STOP,
+    LOG_EVT_BAUD_SWITCH,
+    LOG_EVT_BAUD_REVERTED,
+    LOG_EVT_TEMP_READ,
+    LOG_EVT_TEMP_NO_DEVICE,
+    LOG_EVT_TEMP_SEARCH,
+    LOG_EVT_TEMP_RESOLUTION,
+    LOG_EVT_TEMP_CRC_ERROR,
+    LOG_EVT_DIST_INIT_FAILED,
+    LOG_EVT_DIST_REINIT,
+    LOG_EVT_DIST_CALIB,
+    LOG_EVT_CAP_CALIB,
+    LOG_EVT_CAP_NO_SIGNAL,
+    LOG_EVT_CONFIG,
+    LOG_EVT_COUNT
+} LogEvent;
+
+// 环形缓冲区条目（16字节）
+typedef struct {
+    uint32 timestamp_ms;
+    uint32 timestamp_us;        // timebase_us，运动事件与传感器样本在同一时钟上对齐
+    int32 value;
+    uint8 event;
+    uint8 level;
+    uint8 category;
+    uint8 reserved;
+} LogRecord;
+
+void log_init(void);
+void log_set_level(uint8 level);
+uint8 log_get_level(void);
+void log_set_categories(uint8 mask);
+uint8 log_get_categories(void);
+void log_set_auto_drain(uint8 enable);
+uint8 log_get_auto_drain(void);
+
+void log_write(uint8 level, uint8 category, uint8 event, int32 value);
+uint8 log_pop(LogRecord* record);
+uint16 log_format(char* dst, const LogRecord* record);
+uint16 log_count(void);
+uint32 log_dropped(void);
+
+// 级别过滤放在宏里，被过滤掉的记录只需一次比较，不产生函数调用
+extern uint8 log_level;
+
+#define LOG_AT(lvl, cat, evt, val) \
+    do { if((lvl) <= log_level) log_write((lvl), (cat), (evt), (int32)(val)); } while(0)
+
+#define LOG_ERROR(cat, evt, val)    LOG_AT(LOG_LEVEL_ERROR, (cat), (evt), (val))
+#define LOG_WARN(cat, evt, val)     LOG_AT(LOG_LEVEL_WARN,  (cat), (evt), (val))
+#define LOG_INFO(cat, evt, val)     LOG_AT(LOG_LEVEL_INFO,  (cat), (evt), (val))
+#define LOG_DEBUG(cat, evt, val)    LOG_AT(LOG_LEVEL_DEBUG, (cat), (evt), (val))
+
+#endif /* LOG_H */
+
+/* [] END OF FILE */
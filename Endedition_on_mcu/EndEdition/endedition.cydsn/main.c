@@ -1,50 +1,53 @@
 #include "project.h"
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "cdc_system.h"
+#include "fmt.h"
+#include "parse.h"
+#include "log.h"
+#include "telemetry.h"
+#include "uart_baud.h"
+#include "timebase.h"
+#include "ds18b20.h"
+#include "vl6180x.h"
+#include "i2c_bus.h"
+#include "nvstore.h"
+#include "dist_calib.h"
+#include "filter.h"
+#include "capacitance.h"
+#include "cap_rc.h"
+#include "cap_calib.h"
+#include "snapshot.h"
+#include "sched.h"
+#include "stepper.h"
+#include "config.h"
+#include "profile.h"
 
-#define DEBUG_MODE 1
-
-#define STEPS_PER_MM        100
-#define STEPPER_DELAY       1
-#define MAX_HEIGHT          200.0
-#define MIN_HEIGHT          0.0
-
-#define SERVO_MIN_PULSE     500
-#define SERVO_MAX_PULSE     2500
-#define SERVO_CENTER        1500
-#define MAX_ANGLE           90.0
-#define MIN_ANGLE          -90.0
-
-#define VL6180X_I2C_ADDR    0x29
-#define VL6180X_SYSRANGE_START 0x018
-#define VL6180X_RESULT_RANGE_VAL 0x062
-#define VL6180X_RESULT_INTERRUPT_STATUS_GPIO 0x04F
-#define VL6180X_SYSTEM_INTERRUPT_CLEAR 0x015
+#define FMT_BENCHMARK 0     // 1: 编译 FMT_BENCH 命令（会链接sprintf）
 
+// 步进、高度/角度范围、舵机脉宽和回零参数可在运行中修改，见 config.h（CFG_GET/CFG_SET）
 #define LIMIT_SWITCH_TRIGGERED  0
 #define LIMIT_SWITCH_RELEASED   1
-#define HOMING_SPEED_DELAY      1
-#define HOMING_TIMEOUT         30000 
+#define HOMING_REPORT_STEPS     100
+#define HOME_ENABLE_MS          100     // 清除急停后等待驱动器使能
+#define MOTION_UPDATE_MS        50      // 运动中更新实时位置的间隔
+
+// 任务周期（ms）
+#define SENSOR_TASK_MS          1
+#define HOUSEKEEPING_TASK_MS    1
+#define HEARTBEAT_MS            60000
 
 // 命令缓冲区
 #define CMD_BUFFER_SIZE     128
-#define PARAM_BUFFER_SIZE   64
 
-// ============ 系统状态 ============
-typedef enum {
-    STATUS_READY,
-    STATUS_MOVING,
-    STATUS_ERROR,
-    STATUS_HOMING
-} SystemStatus;
+// 数值参数按0.01精度解析为定点数
+#define PARAM_DECIMALS      2
+#define PARAM_SCALE         100
 
 // ============ 全局变量 ============
 // 系统状态
 SystemStatus system_status = STATUS_READY;
 uint8_t emergency_stop_flag = 0;
-uint8 delay_with_check(uint32 ms);
-uint8 check_for_emergency_command(void);
 
 // 位置状态
 float current_height = 0.0;    // 当前高度 (mm)
@@ -57,16 +60,141 @@ int32_t stepper_position = 0;  // 当前位置（步数）
 
 // 传感器数据
 float temperature = 25.0;       // 温度
-float distance_upper1 = 0.0;   // 上距离传感器1
-float distance_upper2 = 0.0;   // 上距离传感器2（暂时假设）
-float distance_lower1 = 0.0;   // 下距离传感器1（暂时假设）
-float distance_lower2 = 0.0;   // 下距离传感器2（暂时假设）
-float capacitance = 120.5;      // 电容值（暂时假设）
+uint8 temperature_valid = 0;    // 温度读数有效（CRC通过且未过期）
+float distance_upper1 = 0.0;   // 上距离传感器1（VL6180X通道0）
+float distance_upper2 = 0.0;   // 上距离传感器2（通道1）
+float distance_lower1 = 0.0;   // 下距离传感器1（通道2）
+float distance_lower2 = 0.0;   // 下距离传感器2（通道3）
+uint8 distance_valid = 0;       // 各通道有滤波后的距离（bit n = 通道n）
+uint32 ambient_lux_x10[VL6180X_CHANNELS];  // 各通道的环境光（0.1lux，交错模式ALS）
+uint8 ambient_lux_valid = 0;    // bit n = 通道n 的环境光有效
+
+// VL6180X通道到距离变量的映射
+static float* const distance_channel[VL6180X_CHANNELS] = {
+    &distance_upper1, &distance_upper2, &distance_lower1, &distance_lower2
+};
+float capacitance = 0.0;        // 电容（pF，RC充电计时，校准和温度补偿后滤波）
+uint8 capacitance_valid = 0;
 
 // 命令缓冲区
 char cmd_buffer[CMD_BUFFER_SIZE] = {0};
 uint16_t cmd_index = 0;
 
+// 固定的耗时测量点（PROFILE）
+uint8 prof_parse = PROFILE_INVALID;     // 命令拆分
+uint8 prof_tx = PROFILE_INVALID;        // 回复写入UART发送缓冲区（缓冲区满时等待）
+uint8 prof_dist = PROFILE_INVALID;      // 距离：I2C回调、样本出队和滤波
+uint8 prof_temp = PROFILE_INVALID;
+uint8 prof_cap = PROFILE_INVALID;
+uint8 prof_telemetry = PROFILE_INVALID; // 遥测帧格式化和发送
+uint32 cmd_rx_us = 0;           // 当前命令结束符的接收时间（TIME_SYNC）
+
+// 每个命令分支一个测量点，process_command 中按分支设置编号；名称表与枚举顺序一致，启动时全部登记
+typedef enum {
+    PROF_CMD_SET_HEIGHT,
+    PROF_CMD_INIT_HOME,
+    PROF_CMD_CHECK_LIMIT,
+    PROF_CMD_SET_ANGLE,
+    PROF_CMD_MOVE_TO,
+    PROF_CMD_STOP,
+    PROF_CMD_EMERGENCY_STOP,
+    PROF_CMD_HOME,
+    PROF_CMD_GET_STATUS,
+    PROF_CMD_GET_SENSORS,
+    PROF_CMD_GET_TEMPS,
+    PROF_CMD_TEMP_SCAN,
+    PROF_CMD_TEMP_RES,
+    PROF_CMD_TEMP_DIAG,
+    PROF_CMD_DIST_DIAG,
+    PROF_CMD_CAP_ZERO,
+    PROF_CMD_CAP_REF,
+    PROF_CMD_CAP_BASELINE,
+    PROF_CMD_CAP_DIAG,
+    PROF_CMD_SCAN_RATE,
+    PROF_CMD_FILTER,
+    PROF_CMD_DIST_AVG,
+    PROF_CMD_DIST_CAL_OFFSET,
+    PROF_CMD_DIST_CAL_XTALK,
+    PROF_CMD_DIST_CAL,
+    PROF_CMD_CFG_GET,
+    PROF_CMD_CFG_SET,
+    PROF_CMD_CFG_SAVE,
+    PROF_CMD_CFG_DEFAULTS,
+    PROF_CMD_STREAM,
+    PROF_CMD_STREAM_STOP,
+    PROF_CMD_SET_BAUD,
+    PROF_CMD_BAUD_OK,
+    PROF_CMD_TIME_SYNC,
+    PROF_CMD_FMT_BENCH,
+    PROF_CMD_TEST,
+    PROF_CMD_ECHO,
+    PROF_CMD_VERSION,
+    PROF_CMD_HELP,
+    PROF_CMD_DEBUG_ON,
+    PROF_CMD_DEBUG_OFF,
+    PROF_CMD_LOG_LEVEL,
+    PROF_CMD_LOG_DUMP,
+    PROF_CMD_TASKS,
+    PROF_CMD_SLEEP,
+    PROF_CMD_SLEEP_STATS,
+    PROF_CMD_PROFILE,
+    PROF_CMD_INVALID,               // 未知命令
+    PROF_CMD_COUNT
+} ProfileCommand;
+
+static const char* const prof_command_names[PROF_CMD_COUNT] = {
+    "SET_HEIGHT",
+    "INIT_HOME",
+    "CHECK_LIMIT",
+    "SET_ANGLE",
+    "MOVE_TO",
+    "STOP",
+    "EMERGENCY_STOP",
+    "HOME",
+    "GET_STATUS",
+    "GET_SENSORS",
+    "GET_TEMPS",
+    "TEMP_SCAN",
+    "TEMP_RES",
+    "TEMP_DIAG",
+    "DIST_DIAG",
+    "CAP_ZERO",
+    "CAP_REF",
+    "CAP_BASELINE",
+    "CAP_DIAG",
+    "SCAN_RATE",
+    "FILTER",
+    "DIST_AVG",
+    "DIST_CAL_OFFSET",
+    "DIST_CAL_XTALK",
+    "DIST_CAL",
+    "CFG_GET",
+    "CFG_SET",
+    "CFG_SAVE",
+    "CFG_DEFAULTS",
+    "STREAM",
+    "STREAM_STOP",
+    "SET_BAUD",
+    "BAUD_OK",
+    "TIME_SYNC",
+    "FMT_BENCH",
+    "TEST",
+    "ECHO",
+    "VERSION",
+    "HELP",
+    "DEBUG_ON",
+    "DEBUG_OFF",
+    "LOG_LEVEL",
+    "LOG_DUMP",
+    "TASKS",
+    "SLEEP",
+    "SLEEP_STATS",
+    "PROFILE",
+    "(INVALID)"
+};
+
+static uint8 prof_command[PROF_CMD_COUNT];
+
 // ============ 基础功能函数 ============
 
 void uart_print(const char* str) {
@@ -77,168 +205,264 @@ uint8 read_limit_switch(void) {
     return Pin_LimitSwitch_Read();
 }
 
-void float_to_string(char* buffer, float value) {
-    int integer_part = (int)value;
-    int decimal_part = (int)((value - integer_part) * 10);
-    
-    if(decimal_part < 0) decimal_part = -decimal_part;
-    
-    sprintf(buffer, "%d.%d", integer_part, decimal_part);
-}
-
-void int_to_string_with_decimal(char* buffer, int value) {
-    sprintf(buffer, "%d.0", value);
-}
-
 void uart_send_response(const char* response) {
+    uint32 start = PROFILE_START();
+    
     uart_print(response);
+    PROFILE_STOP(prof_tx, start);
 }
 
-void debug_print_with_value(const char* str, float value) {
-    #if DEBUG_MODE
-    char buffer[128];
-    sprintf(buffer, "[DEBUG] %s: %.2f", str, value);
-    uart_print(buffer);
-    uart_print("\r\n");
-    #endif
+const char* system_status_string(void) {
+    if(emergency_stop_flag) {
+        return "EMERGENCY_STOP";
+    }
+    switch(system_status) {
+        case STATUS_READY:  return "READY";
+        case STATUS_MOVING: return "MOVING";
+        case STATUS_ERROR:  return "ERROR";
+        case STATUS_HOMING: return "HOMING";
+        default:            return "UNKNOWN";
+    }
 }
 
-void debug_print(const char* str) {
-    #if DEBUG_MODE
-    uart_print("[DEBUG] ");
-    uart_print(str);
-    uart_print("\r\n");
-    #endif
+// 链路空闲时输出一条缓存的日志
+void log_drain_one(void) {
+    LogRecord record;
+    char line[80];
+    
+    if(log_pop(&record)) {
+        log_format(line, &record);
+        uart_print(line);
+    }
 }
 
 void servo_set_angle(float angle) {
+    float min_angle = (float)config_get(CFG_MIN_ANGLE) / PARAM_SCALE;
+    float max_angle = (float)config_get(CFG_MAX_ANGLE) / PARAM_SCALE;
+    int32 center = config_get(CFG_SERVO_CENTER);
     uint16 pulse_width;
     
-    if(angle < MIN_ANGLE) angle = MIN_ANGLE;
-    if(angle > MAX_ANGLE) angle = MAX_ANGLE;
+    if(angle < min_angle) angle = min_angle;
+    if(angle > max_angle) angle = max_angle;
     
-    pulse_width = SERVO_CENTER + (int16)((angle / 90.0) * (SERVO_MAX_PULSE - SERVO_CENTER));
+    // -90°和+90°分别对应最小和最大脉宽，两侧可以不对称
+    if(angle < 0) {
+        pulse_width = center + (int16)((angle / 90.0) * (center - config_get(CFG_SERVO_MIN_PULSE)));
+    } else {
+        pulse_width = center + (int16)((angle / 90.0) * (config_get(CFG_SERVO_MAX_PULSE) - center));
+    }
     
     PWM_Servo_WriteCompare(pulse_width);
     current_angle = angle;
 }
 
-void process_init_home(void) {
-    char msg[128];
-    uint32 timeout = 0;
-    uint32 steps_moved = 0;
-    
-    uart_send_response("INFO:Starting safe homing sequence...\r\n");
-    
-    // ⭐ 步骤1：首先将伺服电机归中（安全角度）
-    uart_send_response("INFO:Step 1 - Setting servo to center position (0 degrees)...\r\n");
-    servo_set_angle(0.0);
-    CyDelay(1000);  // 等待伺服到位
-    
-    // 确认角度已归零
-    current_angle = 0.0;
-    target_angle = 0.0;
-    uart_send_response("OK:Servo centered at 0 degrees\r\n");
-    
-    // ⭐ 步骤2：清除紧急停止并启用电机
-    emergency_stop_flag = 0;
-    Pin_ENABLE_Write(0);  // 使能步进电机
-    system_status = STATUS_HOMING;
-    
-    // ⭐ 步骤3：检查是否已经在限位开关位置
-    uart_send_response("INFO:Step 2 - Checking limit switch status...\r\n");
-    if(read_limit_switch() == LIMIT_SWITCH_TRIGGERED) {
-        uart_send_response("INFO:Already at home position, backing off...\r\n");
-        
-        // 向下移动一点，离开限位开关
-        Pin_DIR_Write(0);  // 向下方向
-        for(int i = 0; i < 500; i++) {  // 后退500步
-            Pin_STEP_Write(1);
-            CyDelay(2);
-            Pin_STEP_Write(0);
-            CyDelay(2);
-            
-            // 检查紧急停止
-            if(emergency_stop_flag || check_for_emergency_command()) {
-                Pin_ENABLE_Write(1);
-                uart_send_response("ERROR:Homing interrupted\r\n");
-                system_status = STATUS_ERROR;
-                return;
-            }
-            
-            if(read_limit_switch() == LIMIT_SWITCH_RELEASED) {
-                uart_send_response("INFO:Cleared limit switch\r\n");
-                break;
-            }
+// ============ 后台传感器采集 ============
+// 推进各传感器的非阻塞状态机（各自按配置的间隔采样，见 SCAN_RATE），
+// 新读数写入全局缓存和快照后缓冲区，本轮有更新时发布快照
+void sensors_poll(void) {
+    static uint16 logged_reinits[VL6180X_CHANNELS];
+    Vl6180xSample sample;
+    uint8 ch;
+    uint32 start = PROFILE_START();
+    
+    // 执行已完成I2C事务的回调（距离样本在回调中入缓冲区）
+    i2c_bus_poll();
+    
+    // 距离：取出连续测距缓冲区中的全部样本，经滤波后保留各通道的最新值（0.1mm定点）
+    vl6180x_poll();
+    while(vl6180x_pop_sample(&sample)) {
+        if(sample.error_code == 0) {
+            filter_add(FILTER_CH_DIST0 + sample.channel, (int32)sample.range_mm * 10);
+        } else {
+            filter_add_invalid(FILTER_CH_DIST0 + sample.channel);
+            LOG_DEBUG(LOG_CAT_SENSOR, LOG_EVT_DIST_READ_FAILED,
+                      ((int32)sample.channel << 8) | sample.error_code);
+        }
+        if(filter_quality(FILTER_CH_DIST0 + sample.channel) != FILTER_QUALITY_NONE) {
+            *distance_channel[sample.channel] = (float)filter_value(FILTER_CH_DIST0 + sample.channel) / 10.0f;
+            distance_valid |= (uint8)(1u << sample.channel);
+        } else {
+            distance_valid &= (uint8)~(1u << sample.channel);
+        }
+        snapshot_update(SNAPSHOT_DIST0 + sample.channel, filter_value(FILTER_CH_DIST0 + sample.channel),
+                        filter_quality(FILTER_CH_DIST0 + sample.channel), sample.time_us);
+        // 环境光与距离来自同一测量周期，测距出错时ALS结果仍可用
+        if(sample.lux_x10 != VL6180X_LUX_INVALID) {
+            ambient_lux_x10[sample.channel] = sample.lux_x10;
+            ambient_lux_valid |= (uint8)(1u << sample.channel);
+        } else {
+            ambient_lux_valid &= (uint8)~(1u << sample.channel);
         }
-        CyDelay(100);
+        snapshot_update(SNAPSHOT_LUX0 + sample.channel, (int32)sample.lux_x10,
+                        (sample.lux_x10 != VL6180X_LUX_INVALID) ? FILTER_QUALITY_GOOD : FILTER_QUALITY_NONE,
+                        sample.time_us);
     }
-    
-    // ⭐ 步骤4：向上移动寻找限位开关
-    Pin_DIR_Write(1);  // 向上方向
-    CyDelay(10);
-    
-    uart_send_response("INFO:Step 3 - Moving up to find limit switch...\r\n");
-    uart_send_response("INFO:Please ensure area is clear!\r\n");
-    
-    // 慢速向上移动
-    while(read_limit_switch() != LIMIT_SWITCH_TRIGGERED) {
-        // 安全检查
-        if(emergency_stop_flag || check_for_emergency_command()) {
-            Pin_ENABLE_Write(1);
-            uart_send_response("ERROR:Homing interrupted by emergency stop\r\n");
-            system_status = STATUS_ERROR;
-            return;
+    // 驱动在连续错误后自动重新初始化通道，这里只记录
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        if(vl6180x_health(ch)->reinits != logged_reinits[ch]) {
+            logged_reinits[ch] = vl6180x_health(ch)->reinits;
+            distance_valid &= (uint8)~(1u << ch);
+            ambient_lux_valid &= (uint8)~(1u << ch);
+            filter_reset(FILTER_CH_DIST0 + ch);
+            snapshot_update(SNAPSHOT_DIST0 + ch, 0, FILTER_QUALITY_NONE, timebase_us());
+            snapshot_update(SNAPSHOT_LUX0 + ch, 0, FILTER_QUALITY_NONE, timebase_us());
+            LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_DIST_REINIT, ch);
         }
-        
-        // 超时检查
-        if(timeout >= HOMING_TIMEOUT) {
-            Pin_ENABLE_Write(1);
-            uart_send_response("ERROR:Homing timeout - limit switch not found\r\n");
-            uart_send_response("INFO:Check limit switch connection\r\n");
-            system_status = STATUS_ERROR;
-            return;
+    }
+    PROFILE_STOP(prof_dist, start);
+    
+    // 第一个传感器（腔体）作为 GET_SENSORS/STREAM 中的温度
+    // 原始值 LSB = 0.0625°C，换算为0.01°C后滤波；采集时间取读出暂存器时
+    // （转换本身持续到此前最多750ms）
+    start = PROFILE_START();
+    if(ds18b20_poll()) {
+        if(ds18b20_has_reading(0)) {
+            filter_add(FILTER_CH_TEMP, (int32)ds18b20_raw(0) * 25 / 4);
+        } else {
+            filter_add_invalid(FILTER_CH_TEMP);
         }
-        
-        // 执行一步（慢速）
-        Pin_STEP_Write(1);
-        CyDelay(HOMING_SPEED_DELAY);
-        Pin_STEP_Write(0);
-        CyDelay(HOMING_SPEED_DELAY);
-        
-        steps_moved++;
-        timeout += (HOMING_SPEED_DELAY * 2);
-        
-        // 状态报告
-        if(steps_moved % 100 == 0) {
-            sprintf(msg, "INFO:Homing... %lu steps (%.1f mm)\r\n", 
-                    steps_moved, (float)steps_moved / STEPS_PER_MM);
-            uart_send_response(msg);
+        temperature_valid = (filter_quality(FILTER_CH_TEMP) != FILTER_QUALITY_NONE);
+        if(temperature_valid) {
+            temperature = (float)filter_value(FILTER_CH_TEMP) / 100.0f;
         }
+        capacitance_set_temperature(filter_value(FILTER_CH_TEMP), temperature_valid);
+        snapshot_update(SNAPSHOT_TEMP, filter_value(FILTER_CH_TEMP), filter_quality(FILTER_CH_TEMP), timebase_us());
     }
+    PROFILE_STOP(prof_temp, start);
+    
+    // 电容：每个平均值（约160ms）经滤波后更新，整组充电超时计为错误样本；
+    // capacitance_poll() 返回1时刚完成最后一组测量，采集时间取当前时间
+    start = PROFILE_START();
+    if(capacitance_poll(timebase_ms())) {
+        if(capacitance_has_reading()) {
+            filter_add(FILTER_CH_CAP, capacitance_ff());
+        } else {
+            filter_add_invalid(FILTER_CH_CAP);
+            LOG_DEBUG(LOG_CAT_SENSOR, LOG_EVT_CAP_NO_SIGNAL, capacitance_stats()->timeouts);
+        }
+        capacitance_valid = (filter_quality(FILTER_CH_CAP) != FILTER_QUALITY_NONE);
+        if(capacitance_valid) {
+            capacitance = (float)filter_value(FILTER_CH_CAP) / 1000.0f;
+        }
+        snapshot_update(SNAPSHOT_CAP, filter_value(FILTER_CH_CAP), filter_quality(FILTER_CH_CAP), timebase_us());
+    }
+    PROFILE_STOP(prof_cap, start);
     
-    // ⭐ 步骤5：找到限位开关，精确定位
-    uart_send_response("INFO:Step 4 - Limit switch detected, fine-tuning...\r\n");
-    
-    // 后退一点
-    Pin_DIR_Write(0);  // 向下
-    for(int i = 0; i < 20; i++) {
-        Pin_STEP_Write(1);
-        CyDelay(10);
-        Pin_STEP_Write(0);
-        CyDelay(10);
+    snapshot_publish();
+}
+
+// ============ 步进电机控制（运动任务） ============
+// 运动流程是一个状态机：命令只启动运动并返回，步进脉冲由 stepper 在SysTick中断中产生，
+// 每段走完（或被停止、碰到限位开关）时中断唤醒运动任务推进到下一阶段；
+// 运动期间命令、传感器和遥测照常运行，EMERGENCY_STOP/STOP 作为普通命令处理
+typedef enum {
+    MOTION_IDLE,
+    MOTION_MOVE,            // MOVE_TO：走到目标高度后转动舵机
+    MOTION_HOME_ENABLE,     // HOME：清除急停后等待驱动器使能
+    MOTION_HOME_MOVE,       // HOME：回到高度0
+    MOTION_INIT_SERVO,      // INIT_HOME：等待舵机归中
+    MOTION_INIT_BACKOFF,    // 已在限位开关上，向下离开
+    MOTION_INIT_SETTLE,
+    MOTION_INIT_SEEK,       // 向上寻找限位开关
+    MOTION_INIT_FINE_BACK,  // 后退一点
+    MOTION_INIT_FINE_SEEK   // 慢速回到触发点
+} MotionPhase;
+
+static MotionPhase motion_phase = MOTION_IDLE;
+static uint8 motion_stepping = 0;       // 有一段步进的步数尚未计入 stepper_position
+static uint8 motion_stop_request = 0;   // STOP 命令
+static uint32 motion_deadline_ms = 0;   // 定时阶段的结束时间
+static int32 motion_steps_total = 0;    // 当前段的目标步数（绝对值），用于中断报告
+static uint32 homing_steps = 0;         // 寻找限位开关走过的步数
+static uint32 homing_reported = 0;
+
+uint8 task_motion = SCHED_INVALID;
+
+// 步进中断在每段结束时调用
+static void motion_notify(void) {
+    sched_signal(task_motion);
+}
+
+static void motion_step(int32 steps, uint8 half_period_ms, uint8 stop_level) {
+    motion_steps_total = (steps > 0) ? steps : -steps;
+    motion_stepping = stepper_start(steps, half_period_ms, stop_level);
+    sched_wake_after(task_motion, MOTION_UPDATE_MS);
+}
+
+static void motion_wait(MotionPhase phase, uint16 ms) {
+    motion_phase = phase;
+    motion_deadline_ms = timebase_ms() + ms;
+    sched_wake_after(task_motion, ms);
+}
+
+// 把已完成的步数计入位置
+static void motion_commit(void) {
+    if(motion_stepping) {
+        stepper_position += stepper_steps_done();
+        current_height = (float)stepper_position / config_get(CFG_STEPS_PER_MM);
+        motion_stepping = 0;
     }
+}
+
+static void homing_seek_start(void) {
+    uart_send_response("INFO:Step 3 - Moving up to find limit switch...\r\n");
+    uart_send_response("INFO:Please ensure area is clear!\r\n");
+    homing_steps = 0;
+    homing_reported = 0;
+    motion_phase = MOTION_INIT_SEEK;
+    // 向上（负方向）慢速移动，超时换算为步数
+    motion_step(-(config_get(CFG_HOMING_TIMEOUT) / (config_get(CFG_HOMING_SPEED_DELAY) * 2)),
+                (uint8)config_get(CFG_HOMING_SPEED_DELAY), LIMIT_SWITCH_TRIGGERED);
+}
+
+static void homing_failed(const char* message) {
+    Pin_ENABLE_Write(1);
+    uart_send_response(message);
+    LOG_ERROR(LOG_CAT_MOTION, LOG_EVT_HOMING_FAILED, homing_steps);
+    system_status = STATUS_ERROR;
+    motion_phase = MOTION_IDLE;
+}
+
+// 急停或STOP：等当前步完成后计入位置并报告
+static void motion_abort(void) {
+    char msg[64];
+    char* p = msg;
     
-    // 慢速前进到触发点
-    Pin_DIR_Write(1);  // 向上
-    while(read_limit_switch() != LIMIT_SWITCH_TRIGGERED) {
-        Pin_STEP_Write(1);
-        CyDelay(10);
-        Pin_STEP_Write(0);
-        CyDelay(10);
+    if(stepper_state() == STEPPER_RUNNING) {
+        stepper_stop();
+        return;
+    }
+    if(motion_stepping) {
+        int32 done = stepper_steps_done();
+        
+        p += fmt_str(p, "INFO:Stopped at step ");
+        p += fmt_int(p, (done > 0) ? done : -done);
+        p += fmt_str(p, " of ");
+        p += fmt_int(p, motion_steps_total);
+        fmt_str(p, "\r\n");
+        uart_send_response(msg);
     }
+    motion_commit();
     
-    // ⭐ 步骤6：重置所有位置参数
+    if(motion_phase == MOTION_MOVE) {
+        uart_send_response("ERROR:MOVEMENT_INTERRUPTED\r\n");
+        LOG_WARN(LOG_CAT_MOTION, LOG_EVT_MOVE_INTERRUPTED, stepper_position);
+    } else if(motion_phase == MOTION_INIT_SEEK) {
+        uart_send_response("ERROR:Homing interrupted by emergency stop\r\n");
+    } else {
+        uart_send_response("ERROR:Homing interrupted\r\n");
+    }
+    if(emergency_stop_flag) {
+        Pin_ENABLE_Write(1);
+        system_status = STATUS_ERROR;
+    } else {
+        system_status = STATUS_READY;
+    }
+    motion_stop_request = 0;
+    motion_phase = MOTION_IDLE;
+}
+
+static void homing_complete(void) {
     stepper_position = 0;
     current_height = 0.0;
     current_angle = 0.0;
@@ -246,357 +470,223 @@ void process_init_home(void) {
     target_angle = 0.0;
     
     system_status = STATUS_READY;
+    motion_phase = MOTION_IDLE;
     
     // ⭐ 完成报告
     uart_send_response("=====================================\r\n");
     uart_send_response("OK:Homing complete!\r\n");
+    LOG_INFO(LOG_CAT_MOTION, LOG_EVT_HOMING_DONE, homing_steps);
     uart_send_response("  - Servo angle: 0.0 degrees\r\n");
     uart_send_response("  - Height: 0.0 mm (at limit switch)\r\n");
     uart_send_response("  - System ready for operation\r\n");
     uart_send_response("=====================================\r\n");
 }
 
-// ============ VL6180X距离传感器函数 ============
-void vl6180x_write_byte(uint16 reg_addr, uint8 data) {
-    uint32 status;
+// 寻找限位开关时每 HOMING_REPORT_STEPS 步报告一次
+static void homing_report(void) {
+    char msg[64];
+    char* p = msg;
+    uint32 steps = (uint32)(-stepper_steps_done());
     
-    status = I2C_Distance_I2CMasterSendStart(VL6180X_I2C_ADDR, I2C_Distance_I2C_WRITE_XFER_MODE, 100);
-    if(status != I2C_Distance_I2C_MSTR_NO_ERROR) {
-        I2C_Distance_I2CMasterSendStop(100);
+    if(steps / HOMING_REPORT_STEPS == homing_reported / HOMING_REPORT_STEPS) {
         return;
     }
-    
-    I2C_Distance_I2CMasterWriteByte((reg_addr >> 8) & 0xFF, 100);
-    I2C_Distance_I2CMasterWriteByte(reg_addr & 0xFF, 100);
-    I2C_Distance_I2CMasterWriteByte(data, 100);
-    I2C_Distance_I2CMasterSendStop(100);
-}
-
-uint8 vl6180x_read_byte(uint16 reg_addr) {
-    uint32 status;
-    uint8 read_data = 0;
-    
-    status = I2C_Distance_I2CMasterSendStart(VL6180X_I2C_ADDR, I2C_Distance_I2C_WRITE_XFER_MODE, 100);
-    if(status != I2C_Distance_I2C_MSTR_NO_ERROR) {
-        I2C_Distance_I2CMasterSendStop(100);
-        return 0;
-    }
-    
-    I2C_Distance_I2CMasterWriteByte((reg_addr >> 8) & 0xFF, 100);
-    I2C_Distance_I2CMasterWriteByte(reg_addr & 0xFF, 100);
-    
-    I2C_Distance_I2CMasterSendRestart(VL6180X_I2C_ADDR, I2C_Distance_I2C_READ_XFER_MODE, 100);
-    I2C_Distance_I2CMasterReadByte(I2C_Distance_I2C_NAK_DATA, &read_data, 100);
-    I2C_Distance_I2CMasterSendStop(100);
-    
-    return read_data;
+    homing_reported = steps;
+    steps -= steps % HOMING_REPORT_STEPS;
+    p += fmt_str(p, "INFO:Homing... ");
+    p += fmt_uint(p, steps);
+    p += fmt_str(p, " steps (");
+    p += fmt_fixed(p, (int32)(steps * 10 / config_get(CFG_STEPS_PER_MM)), 1);
+    fmt_str(p, " mm)\r\n");
+    uart_send_response(msg);
 }
 
-uint8 read_distance_sensor(void) {
-    uint8 status, distance;
-    uint16 timeout = 0;
-    
-    vl6180x_write_byte(VL6180X_SYSTEM_INTERRUPT_CLEAR, 0x07);
-    vl6180x_write_byte(VL6180X_SYSRANGE_START, 0x01);
-    
-    do {
-        CyDelay(1);
-        status = vl6180x_read_byte(VL6180X_RESULT_INTERRUPT_STATUS_GPIO);
-        timeout++;
-        if(timeout > 100) return 0xFF;
-    } while((status & 0x04) == 0);
-    
-    distance = vl6180x_read_byte(VL6180X_RESULT_RANGE_VAL);
-    vl6180x_write_byte(VL6180X_SYSTEM_INTERRUPT_CLEAR, 0x07);
+static void motion_home_start(void) {
+    system_status = STATUS_HOMING;
+    uart_send_response("INFO:Homing started\r\n");
+    LOG_INFO(LOG_CAT_MOTION, LOG_EVT_HOMING_START, stepper_position);
     
-    return distance;
+    servo_set_angle(0.0);
+    motion_phase = MOTION_HOME_MOVE;
+    motion_step(-stepper_position, (uint8)config_get(CFG_STEP_DELAY), STEPPER_LIMIT_IGNORE);
 }
 
-// ============ DS18B20温度传感器函数 ============
-float read_temperature(void) {
-    uint8 temp_lsb, temp_msb;
-    int16 temp_raw;
-    float temperature_value;
+// 运动任务：由步进结束事件或定时唤醒
+void motion_task(void) {
+    uint8 result;
     
-    // Reset pulse
-    OneWire_Pin_Write(0);
-    CyDelayUs(480);
-    OneWire_Pin_Write(1);
-    CyDelayUs(480);
-    
-    // Skip ROM - 0xCC
-    uint8 cmd = 0xCC;
-    for (int i = 0; i < 8; i++) {
-        if (cmd & 0x01) {
-            OneWire_Pin_Write(0);
-            CyDelayUs(6);
-            OneWire_Pin_Write(1);
-            CyDelayUs(64);
-        } else {
-            OneWire_Pin_Write(0);
-            CyDelayUs(60);
-            OneWire_Pin_Write(1);
-            CyDelayUs(10);
-        }
-        cmd >>= 1;
-    }
-    
-    // Convert T - 0x44
-    cmd = 0x44;
-    for (int i = 0; i < 8; i++) {
-        if (cmd & 0x01) {
-            OneWire_Pin_Write(0);
-            CyDelayUs(6);
-            OneWire_Pin_Write(1);
-            CyDelayUs(64);
-        } else {
-            OneWire_Pin_Write(0);
-            CyDelayUs(60);
-            OneWire_Pin_Write(1);
-            CyDelayUs(10);
-        }
-        cmd >>= 1;
-    }
-    
-    CyDelay(750);  // 等待转换
-    
-    // 再次复位并读取
-    OneWire_Pin_Write(0);
-    CyDelayUs(480);
-    OneWire_Pin_Write(1);
-    CyDelayUs(480);
-    
-    // Skip ROM - 0xCC
-    cmd = 0xCC;
-    for (int i = 0; i < 8; i++) {
-        if (cmd & 0x01) {
-            OneWire_Pin_Write(0);
-            CyDelayUs(6);
-            OneWire_Pin_Write(1);
-            CyDelayUs(64);
-        } else {
-            OneWire_Pin_Write(0);
-            CyDelayUs(60);
-            OneWire_Pin_Write(1);
-            CyDelayUs(10);
-        }
-        cmd >>= 1;
-    }
-    
-    // Read Scratchpad - 0xBE
-    cmd = 0xBE;
-    for (int i = 0; i < 8; i++) {
-        if (cmd & 0x01) {
-            OneWire_Pin_Write(0);
-            CyDelayUs(6);
-            OneWire_Pin_Write(1);
-            CyDelayUs(64);
-        } else {
-            OneWire_Pin_Write(0);
-            CyDelayUs(60);
-            OneWire_Pin_Write(1);
-            CyDelayUs(10);
-        }
-        cmd >>= 1;
+    if(motion_phase == MOTION_IDLE) {
+        return;
     }
-    
-    // Read LSB
-    temp_lsb = 0;
-    for (int i = 0; i < 8; i++) {
-        temp_lsb >>= 1;
-        OneWire_Pin_Write(0);
-        CyDelayUs(3);
-        OneWire_Pin_Write(1);
-        CyDelayUs(12);
-        if (OneWire_Pin_Read()) {
-            temp_lsb |= 0x80;
-        }
-        CyDelayUs(50);
+    // 步进被停止后急停标志可能已被 RESET 清除，仍按中断处理
+    if(emergency_stop_flag || motion_stop_request ||
+       (motion_stepping && stepper_state() == STEPPER_STOPPED)) {
+        motion_abort();
+        return;
     }
     
-    // Read MSB
-    temp_msb = 0;
-    for (int i = 0; i < 8; i++) {
-        temp_msb >>= 1;
-        OneWire_Pin_Write(0);
-        CyDelayUs(3);
-        OneWire_Pin_Write(1);
-        CyDelayUs(12);
-        if (OneWire_Pin_Read()) {
-            temp_msb |= 0x80;
+    // 步进进行中：更新实时位置供 GET_STATUS/STREAM 使用
+    result = stepper_state();
+    if(result == STEPPER_RUNNING) {
+        current_height = (float)(stepper_position + stepper_steps_done()) / config_get(CFG_STEPS_PER_MM);
+        if(motion_phase == MOTION_INIT_SEEK) {
+            homing_report();
         }
-        CyDelayUs(50);
+        sched_wake_after(task_motion, MOTION_UPDATE_MS);
+        return;
     }
-    
-    temp_raw = (temp_msb << 8) | temp_lsb;
-    temperature_value = temp_raw * 0.0625;
-    
-    return temperature_value;
-}
-
-uint8 check_for_emergency_command(void) {
-    if(UART_SpiUartGetRxBufferSize() > 0) {
-        char temp_buffer[20];
-        uint8 i = 0;
-        
-        while(UART_SpiUartGetRxBufferSize() > 0 && i < 19) {
-            temp_buffer[i++] = UART_UartGetChar();
-        }
-        temp_buffer[i] = '\0';
-        
-        if(strstr(temp_buffer, "EMERGENCY") != NULL) {
-            emergency_stop_flag = 1;
-            uart_send_response("INFO:Emergency detected during move\r\n");
-            return 1;
-        }
+    // 定时阶段未到期（步进段的剩余唤醒）
+    if((motion_phase == MOTION_HOME_ENABLE || motion_phase == MOTION_INIT_SERVO ||
+        motion_phase == MOTION_INIT_SETTLE) && !TIMEBASE_EXPIRED(timebase_ms(), motion_deadline_ms)) {
+        return;
     }
-    return 0;
-}
-
-uint8 delay_with_check(uint32 ms) {
-    uint32 i;
-    
-    for(i = 0; i < ms; i++) {
-        if(emergency_stop_flag) {
-            return 0;
-        }
-        if(check_for_emergency_command()) {
-            return 0;
-        }
-        CyDelay(1);
+    if(motion_phase == MOTION_INIT_SEEK) {
+        homing_steps = (uint32)(-stepper_steps_done());
     }
-    return 1;
-}
-
-
-
-// ============ 步进电机控制函数 ============
-void stepper_move_steps(int32 steps) {
-    uint8 dir = (steps > 0) ? 0 : 1;
-    int32 abs_steps = (steps > 0) ? steps : -steps;
-    int32 steps_completed = 0;
-    int32 i;
-    char msg[64];
-    
-    Pin_DIR_Write(dir);
-    CyDelay(10);
-    
-    for(i = 0; i < abs_steps; i++) {
-        if(emergency_stop_flag) {
-            if(dir) {
-                stepper_position += steps_completed;
+    motion_commit();
+    
+    switch(motion_phase) {
+        case MOTION_MOVE:
+            servo_set_angle(target_angle);
+            system_status = STATUS_READY;
+            motion_phase = MOTION_IDLE;
+            LOG_INFO(LOG_CAT_MOTION, LOG_EVT_MOVE_DONE, stepper_position);
+            uart_send_response("OK\r\n");
+            break;
+            
+        case MOTION_HOME_ENABLE:
+            uart_send_response("INFO:Motors re-enabled\r\n");
+            motion_home_start();
+            break;
+            
+        case MOTION_HOME_MOVE:
+            stepper_position = 0;
+            current_height = 0.0;
+            current_angle = 0.0;
+            system_status = STATUS_READY;
+            motion_phase = MOTION_IDLE;
+            uart_send_response("OK:HOME\r\n");
+            LOG_INFO(LOG_CAT_MOTION, LOG_EVT_HOMING_DONE, 0);
+            break;
+            
+        case MOTION_INIT_SERVO:
+            // 确认角度已归零
+            current_angle = 0.0;
+            target_angle = 0.0;
+            uart_send_response("OK:Servo centered at 0 degrees\r\n");
+            
+            // ⭐ 检查是否已经在限位开关位置
+            uart_send_response("INFO:Step 2 - Checking limit switch status...\r\n");
+            if(read_limit_switch() == LIMIT_SWITCH_TRIGGERED) {
+                uart_send_response("INFO:Already at home position, backing off...\r\n");
+                // 向下移动一点，离开限位开关
+                motion_phase = MOTION_INIT_BACKOFF;
+                motion_step(config_get(CFG_HOMING_BACKOFF_STEPS), (uint8)config_get(CFG_HOMING_BACKOFF_DELAY),
+                            LIMIT_SWITCH_RELEASED);
             } else {
-                stepper_position -= steps_completed;
+                homing_seek_start();
             }
-            current_height = (float)stepper_position / STEPS_PER_MM;
+            break;
             
-            Pin_ENABLE_Write(1);
-            system_status = STATUS_ERROR;
-            
-            char msg[64];
-            sprintf(msg, "INFO:Stopped at step %ld of %ld\r\n", steps_completed, abs_steps);
-            uart_send_response(msg);
-            return;
-        }
-        
-        if(i % 100 == 0) {
-            if(UART_SpiUartGetRxBufferSize() >= 14) { 
-                char peek_buf[20];
-                uint8 j;
-                
-                for(j = 0; j < 14 && UART_SpiUartGetRxBufferSize() > 0; j++) {
-                    peek_buf[j] = UART_UartGetChar();
-                }
-                peek_buf[j] = '\0';
-                
-                if(strstr(peek_buf, "EMERGENCY") != NULL) {
-                    emergency_stop_flag = 1;
-                    
-                    if(dir) {
-                        stepper_position += steps_completed;
-                    } else {
-                        stepper_position -= steps_completed;
-                    }
-                    current_height = (float)stepper_position / STEPS_PER_MM;
-                    
-                    Pin_ENABLE_Write(1);
-                    uart_send_response("EMERGENCY:Stopped\r\n");
-                    
-                    sprintf(msg, "INFO:Position: %.1f mm\r\n", current_height);
-                    uart_send_response(msg);
-                    return;
-                }
+        case MOTION_INIT_BACKOFF:
+            if(stepper_state() == STEPPER_LIMIT) {
+                uart_send_response("INFO:Cleared limit switch\r\n");
             }
-        }
-        Pin_STEP_Write(1);
-        if(!delay_with_check(STEPPER_DELAY)) {
-            if(dir) {
-                stepper_position += steps_completed;
-            } else {
-                stepper_position -= steps_completed;
+            motion_wait(MOTION_INIT_SETTLE, (uint16)config_get(CFG_HOMING_SETTLE_MS));
+            break;
+            
+        case MOTION_INIT_SETTLE:
+            homing_seek_start();
+            break;
+            
+        case MOTION_INIT_SEEK:
+            if(stepper_state() != STEPPER_LIMIT) {
+                homing_failed("ERROR:Homing timeout - limit switch not found\r\n");
+                uart_send_response("INFO:Check limit switch connection\r\n");
+                break;
             }
-            current_height = (float)stepper_position / STEPS_PER_MM;
-            Pin_ENABLE_Write(1);
-            return;
-        }
-        Pin_STEP_Write(0);
-        if(!delay_with_check(STEPPER_DELAY)) {
-            if(dir) {
-                stepper_position += steps_completed;
-            } else {
-                stepper_position -= steps_completed;
+            // ⭐ 找到限位开关，后退一点再慢速回到触发点
+            uart_send_response("INFO:Step 4 - Limit switch detected, fine-tuning...\r\n");
+            motion_phase = MOTION_INIT_FINE_BACK;
+            motion_step(config_get(CFG_HOMING_FINE_STEPS), (uint8)config_get(CFG_HOMING_FINE_DELAY),
+                        STEPPER_LIMIT_IGNORE);
+            break;
+            
+        case MOTION_INIT_FINE_BACK:
+            motion_phase = MOTION_INIT_FINE_SEEK;
+            motion_step(-config_get(CFG_HOMING_FINE_MAX_STEPS), (uint8)config_get(CFG_HOMING_FINE_DELAY),
+                        LIMIT_SWITCH_TRIGGERED);
+            break;
+            
+        case MOTION_INIT_FINE_SEEK:
+            if(stepper_state() != STEPPER_LIMIT) {
+                homing_failed("ERROR:Homing failed - limit switch lost during fine-tuning\r\n");
+                break;
             }
-            current_height = (float)stepper_position / STEPS_PER_MM;
-            Pin_ENABLE_Write(1);
-            return;
-        }
-        steps_completed++;
+            homing_complete();
+            break;
+            
+        default:
+            motion_phase = MOTION_IDLE;
+            break;
     }
-    
-    stepper_position += steps;
-    current_height = (float)stepper_position / STEPS_PER_MM;
 }
 
-void stepper_move_to_height(float height_mm) {
-    int32_t target_steps = (int32_t)(height_mm * STEPS_PER_MM);
-    int32_t delta = target_steps - stepper_position;
-    
-    if(delta != 0) {
-        stepper_move_steps(delta);
+// ============ 命令处理函数 ============
+void send_parse_error(uint8 result) {
+    switch(result) {
+        case PARSE_ERR_MISSING:  uart_send_response("ERROR:MISSING_PARAM\r\n"); break;
+        case PARSE_ERR_OVERFLOW: uart_send_response("ERROR:OUT_OF_RANGE\r\n"); break;
+        case PARSE_ERR_EXTRA:    uart_send_response("ERROR:TOO_MANY_PARAMS\r\n"); break;
+        default:                 uart_send_response("ERROR:INVALID_NUMBER\r\n"); break;
     }
 }
 
-// ============ 命令处理函数 ============
 void process_set_height(const char* params) {
+    int32 height;
+    uint8 result;
+    
     if(emergency_stop_flag) {
         uart_send_response("ERROR:EMERGENCY_STOP_ACTIVE\r\n");
         return;
     }
     
-    float height = atof(params);
+    result = parse_fixed_fields(params, &height, 1, PARAM_DECIMALS);
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
     
-    if(height < MIN_HEIGHT || height > MAX_HEIGHT) {
+    if(height < config_get(CFG_MIN_HEIGHT) || height > config_get(CFG_MAX_HEIGHT)) {
         uart_send_response("ERROR:OUT_OF_RANGE\r\n");
         return;
     }
     
-    target_height = height;
+    target_height = (float)height / PARAM_SCALE;
     uart_send_response("OK\r\n");
 }
 
 void process_set_angle(const char* params) {
+    int32 angle;
+    uint8 result;
+    
     if(emergency_stop_flag) {
         uart_send_response("ERROR:EMERGENCY_STOP_ACTIVE\r\n");
         return;
     }
-    float angle = atof(params);
     
-    if(angle < MIN_ANGLE || angle > MAX_ANGLE) {
+    result = parse_fixed_fields(params, &angle, 1, PARAM_DECIMALS);
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    
+    if(angle < config_get(CFG_MIN_ANGLE) || angle > config_get(CFG_MAX_ANGLE)) {
         uart_send_response("ERROR:OUT_OF_RANGE\r\n");
         return;
     }
     
-    target_angle = angle;
+    target_angle = (float)angle / PARAM_SCALE;
     uart_send_response("OK\r\n");
 }
 
@@ -605,48 +695,47 @@ void process_move_to(const char* params) {
         uart_send_response("ERROR:EMERGENCY_STOP_ACTIVE\r\n");
         return;
     }
-    float height, angle;
-    char* comma;
-    char params_copy[PARAM_BUFFER_SIZE];
-    
-    strcpy(params_copy, params);
-    comma = strchr(params_copy, ',');
+    int32 values[2];    // 高度, 角度
+    uint8 result;
     
-    if(comma == NULL) {
-        uart_send_response("ERROR:INVALID_COMMAND\r\n");
+    result = parse_fixed_fields(params, values, 2, PARAM_DECIMALS);
+    if(result != PARSE_OK) {
+        send_parse_error(result);
         return;
     }
     
-    *comma = '\0';
-    height = atof(params_copy);
-    angle = atof(comma + 1);
-    
-    if(height < MIN_HEIGHT || height > MAX_HEIGHT || 
-       angle < MIN_ANGLE || angle > MAX_ANGLE) {
+    if(values[0] < config_get(CFG_MIN_HEIGHT) || values[0] > config_get(CFG_MAX_HEIGHT) || 
+       values[1] < config_get(CFG_MIN_ANGLE) || values[1] > config_get(CFG_MAX_ANGLE)) {
         uart_send_response("ERROR:OUT_OF_RANGE\r\n");
         return;
     }
     
-    target_height = height;
-    target_angle = angle;
-    system_status = STATUS_MOVING;
-    
-    // 执行移动
-    stepper_move_to_height(target_height);
-    servo_set_angle(target_angle);
-    
-    if(emergency_stop_flag) {
-        uart_send_response("ERROR:MOVEMENT_INTERRUPTED\r\n");
+    if(motion_phase != MOTION_IDLE) {
+        uart_send_response("ERROR:BUSY\r\n");
         return;
     }
     
-    system_status = STATUS_READY;
-    uart_send_response("OK\r\n");
+    target_height = (float)values[0] / PARAM_SCALE;
+    target_angle = (float)values[1] / PARAM_SCALE;
+    system_status = STATUS_MOVING;
+    LOG_INFO(LOG_CAT_MOTION, LOG_EVT_MOVE_START, values[0]);
+    
+    // 启动移动，到位后运动任务转动舵机并回复 OK（或 ERROR:MOVEMENT_INTERRUPTED）
+    motion_stop_request = 0;
+    motion_phase = MOTION_MOVE;
+    motion_step((int32)(target_height * config_get(CFG_STEPS_PER_MM)) - stepper_position,
+                (uint8)config_get(CFG_STEP_DELAY), STEPPER_LIMIT_IGNORE);
 }
 
 void process_stop(void) {
-    // 停止当前动作
-    system_status = STATUS_READY;
+    // 停止当前动作：当前步完成后停止，原运动命令回复中断
+    if(motion_phase != MOTION_IDLE) {
+        motion_stop_request = 1;
+        stepper_stop();
+        sched_signal(task_motion);
+    } else {
+        system_status = STATUS_READY;
+    }
     uart_send_response("OK\r\n");
 }
 
@@ -657,42 +746,48 @@ void process_reset(void) {
     uart_send_response("OK:System reset\r\n");
 }
 
+// 回到高度0，完成后运动任务回复 OK:HOME
 void process_home(void) {
+    if(motion_phase != MOTION_IDLE) {
+        uart_send_response("ERROR:BUSY\r\n");
+        return;
+    }
+    motion_stop_request = 0;
+    
     if(emergency_stop_flag) {
         uart_send_response("INFO:Clearing emergency stop\r\n");
         emergency_stop_flag = 0;
         Pin_ENABLE_Write(0);
-        CyDelay(100); 
-        uart_send_response("INFO:Motors re-enabled\r\n");
-    } else {
-        Pin_ENABLE_Write(0);
-    }
-    
-    system_status = STATUS_HOMING;
-    
-    uart_send_response("INFO:Homing started\r\n");
-    
-    servo_set_angle(0.0);
-    
-    if(check_for_emergency_command()) {
-        system_status = STATUS_ERROR;
-        uart_send_response("ERROR:Homing interrupted\r\n");
+        system_status = STATUS_HOMING;
+        motion_wait(MOTION_HOME_ENABLE, HOME_ENABLE_MS);
         return;
     }
     
-    stepper_move_to_height(0.0);
-    
-    if(emergency_stop_flag) {
-        uart_send_response("ERROR:Homing interrupted\r\n");
+    Pin_ENABLE_Write(0);
+    motion_home_start();
+}
+
+// 安全回零：舵机归中 -> 离开限位开关 -> 向上寻找限位开关 -> 精确定位，
+// 各阶段由运动任务推进，命令立即返回
+void process_init_home(void) {
+    if(motion_phase != MOTION_IDLE) {
+        uart_send_response("ERROR:BUSY\r\n");
         return;
     }
     
-    stepper_position = 0;
-    current_height = 0.0;
-    current_angle = 0.0;
+    uart_send_response("INFO:Starting safe homing sequence...\r\n");
+    LOG_INFO(LOG_CAT_MOTION, LOG_EVT_HOMING_START, stepper_position);
     
-    system_status = STATUS_READY;
-    uart_send_response("OK:HOME\r\n");
+    // 清除紧急停止并启用电机；舵机归中期间的急停会中止回零
+    emergency_stop_flag = 0;
+    motion_stop_request = 0;
+    Pin_ENABLE_Write(0);
+    system_status = STATUS_HOMING;
+    
+    // ⭐ 步骤1：首先将伺服电机归中（安全角度）
+    uart_send_response("INFO:Step 1 - Setting servo to center position (0 degrees)...\r\n");
+    servo_set_angle(0.0);
+    motion_wait(MOTION_INIT_SERVO, (uint16)config_get(CFG_SERVO_SETTLE_MS));
 }
 
 void process_emergency_stop(void) {
@@ -701,25 +796,17 @@ void process_emergency_stop(void) {
     
     // 立即停止所有电机
     Pin_ENABLE_Write(1);  // 禁用步进电机
+    stepper_stop();
+    sched_signal(task_motion);
     
     uart_send_response("OK:EMERGENCY_STOP\r\n");
-    debug_print("EMERGENCY STOP ACTIVATED - All motors disabled");
+    LOG_WARN(LOG_CAT_MOTION, LOG_EVT_EMERGENCY_STOP, stepper_position);
 }
 
+// STATUS:状态,高度,角度,时间（us，与 TIME_SYNC 同一时钟）
 void process_get_status(void) {
     char response[128];
-    const char* status_str;
-     if(emergency_stop_flag) {
-        status_str = "EMERGENCY_STOP";
-    } else {
-        switch(system_status) {
-            case STATUS_READY:  status_str = "READY"; break;
-            case STATUS_MOVING: status_str = "MOVING"; break;
-            case STATUS_ERROR:  status_str = "ERROR"; break;
-            case STATUS_HOMING: status_str = "HOMING"; break;
-            default: status_str = "UNKNOWN"; break;
-        }
-    }
+    const char* status_str = system_status_string();
     float h = current_height;
     float a = current_angle;
     if(h == 0.0 && a == 0.0 && stepper_position == 0) {
@@ -727,67 +814,1231 @@ void process_get_status(void) {
         a = 0.0;
     }
     
-    sprintf(response, "STATUS:%s,%.1f,%.1f\r\n", 
-            status_str, h, a);
+    char* p = response;
+    p += fmt_str(p, "STATUS:");
+    p += fmt_str(p, status_str);
+    p += fmt_char(p, ',');
+    p += fmt_float(p, h, 1);
+    p += fmt_char(p, ',');
+    p += fmt_float(p, a, 1);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, timebase_us());
+    fmt_str(p, "\r\n");
     uart_send_response(response);
 }
 
+// 只格式化后台采集发布的快照，不做传感器I/O
+// SENSORS:距离x4,温度,角度,电容,环境光x4,质量,序号,年龄x10,采集时间x10
+// 质量：四路距离、温度、电容各一位（0无数据 1填充中 2正常 3有剔除）
+// 年龄：各快照字段（距离x4、温度、电容、环境光x4）距最后更新的ms，从未更新为NA
+// 采集时间：同样顺序的各字段样本时间（us，timebase_us），从未更新为NA
 void process_get_sensors(void) {
-    char response[256];
-    char temp_str[8][16];
-    uint8 dist;
-    
-    int dist1 = 12;
-    int dist2 = 13;
-    int dist3 = 156;
-    int dist4 = 157;
-    float temp = 25.0;
-    float angle = 80.0;
-    float cap = 120.5;
-    
-    dist = read_distance_sensor();
-    if(dist != 0xFF && dist > 0) {
-        dist1 = dist;
-        dist2 = dist + 1;
-    } else {
-        debug_print("Distance sensor read failed, using default");
+    static const uint8 decimals[SNAPSHOT_FIELDS] = { 1, 1, 1, 1, 2, 3, 1, 1, 1, 1 };
+    const SensorSnapshot* snap = snapshot_front();
+    char response[384];
+    char* p = response;
+    uint32 age;
+    uint8 field;
+    
+    p += fmt_str(p, "SENSORS:");
+    for(field = 0; field < SNAPSHOT_FIELDS; field++) {
+        if(field > 0) {
+            p += fmt_char(p, ',');
+        }
+        // 角度没有传感器，使用舵机当前角度
+        if(field == SNAPSHOT_CAP) {
+            p += fmt_float(p, current_angle, 1);
+            p += fmt_char(p, ',');
+        }
+        if(snap->quality[field] != FILTER_QUALITY_NONE) {
+            p += fmt_fixed(p, snap->value[field], decimals[field]);
+        } else {
+            p += fmt_str(p, "NA");
+        }
     }
+    p += fmt_char(p, ',');
+    for(field = 0; field < FILTER_CHANNELS; field++) {
+        p += fmt_char(p, (char)('0' + snap->quality[field]));
+    }
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, snap->seq);
+    for(field = 0; field < SNAPSHOT_FIELDS; field++) {
+        p += fmt_char(p, ',');
+        age = snapshot_age_ms(snap, field);
+        if(age != SNAPSHOT_NEVER) {
+            p += fmt_uint(p, age);
+        } else {
+            p += fmt_str(p, "NA");
+        }
+    }
+    for(field = 0; field < SNAPSHOT_FIELDS; field++) {
+        p += fmt_char(p, ',');
+        if(snap->written & (1u << field)) {
+            p += fmt_uint(p, snap->acquired_us[field]);
+        } else {
+            p += fmt_str(p, "NA");
+        }
+    }
+    fmt_str(p, "\r\n");
     
-    dist3 = 156 + (rand() % 5);
-    dist4 = 157 + (rand() % 5);
-    
-    temp = 25.0 + ((float)(rand() % 100) / 10.0);
+    LOG_DEBUG(LOG_CAT_SENSOR, LOG_EVT_SENSORS_SENT, snap->seq);
     
-    cap = 120.5 + (current_height * 0.5);
+    uart_send_response(response);
+}
+
+// 各温度点的缓存读数：TEMPS:n,t0,t1,...（无读数的传感器输出 NA）
+void process_get_temps(void) {
+    char msg[64];
+    char* p = msg;
+    uint8 i;
+    
+    p += fmt_str(p, "TEMPS:");
+    p += fmt_uint(p, ds18b20_count());
+    for(i = 0; i < ds18b20_count(); i++) {
+        p += fmt_char(p, ',');
+        if(ds18b20_has_reading(i)) {
+            p += fmt_float(p, ds18b20_celsius(i), 2);
+        } else {
+            p += fmt_str(p, "NA");
+        }
+    }
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+}
+
+// 重新枚举1-Wire总线：TEMP_SCAN:n,rom0,rom1,...（ROM码为16位十六进制，CRC字节在前）
+void process_temp_scan(void) {
+    char msg[96];
+    char* p = msg;
+    const uint8* rom;
+    uint8 count;
+    uint8 i;
+    int8 b;
+    
+    count = ds18b20_search();
+    
+    p += fmt_str(p, "TEMP_SCAN:");
+    p += fmt_uint(p, count);
+    for(i = 0; i < count; i++) {
+        rom = ds18b20_rom(i);
+        p += fmt_char(p, ',');
+        for(b = ONEWIRE_ROM_SIZE - 1; b >= 0; b--) {
+            p += fmt_hex8(p, rom[b]);
+        }
+    }
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+}
+
+// TEMP_RES:bits[,index] - 设置分辨率，省略index时设置全部传感器
+void process_temp_res(const char* params) {
+    const char* p = params;
+    uint32 bits;
+    uint32 index;
+    uint8 first = 0;
+    uint8 last = ds18b20_count();
+    uint8 result;
+    uint8 i;
+    char msg[48];
+    char* out = msg;
+    
+    result = parse_uint(&p, &bits);
+    if(result == PARSE_OK && *p == ',') {
+        p++;
+        result = parse_uint(&p, &index);
+        first = (uint8)((index < 0xFF) ? index : 0xFF);
+        last = first + 1;
+    }
+    if(result == PARSE_OK && *p != '\0') {
+        result = PARSE_ERR_EXTRA;
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    
+    if(ds18b20_count() == 0 || first >= ds18b20_count()) {
+        uart_send_response("ERROR:INVALID_INDEX\r\n");
+        return;
+    }
+    if(bits < DS18B20_RES_MIN || bits > DS18B20_RES_MAX) {
+        uart_send_response("ERROR:INVALID_RESOLUTION\r\n");
+        return;
+    }
+    
+    result = DS18B20_OK;
+    for(i = first; i < last && result == DS18B20_OK; i++) {
+        result = ds18b20_set_resolution(i, (uint8)bits);
+    }
+    if(result != DS18B20_OK) {
+        uart_send_response("ERROR:TEMP_BUS\r\n");
+        return;
+    }
+    
+    out += fmt_str(out, "OK:TEMP_RES,");
+    out += fmt_uint(out, bits);
+    out += fmt_str(out, ",conv_ms=");
+    out += fmt_uint(out, ds18b20_conversion_time_ms((uint8)bits));
+    fmt_str(out, "\r\n");
+    uart_send_response(msg);
+}
+
+// 1-Wire诊断：TEMP_DIAG:n,bus_err 后每个传感器一行
+// TEMP<i>:rom,res,ok,crc_err,no_resp,retries,failed
+void process_temp_diag(void) {
+    char msg[96];
+    char* p;
+    const Ds18b20Stats* stats;
+    const uint8* rom;
+    uint8 i;
+    int8 b;
+    
+    p = msg;
+    p += fmt_str(p, "TEMP_DIAG:");
+    p += fmt_uint(p, ds18b20_count());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, ds18b20_bus_errors());
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    for(i = 0; i < ds18b20_count(); i++) {
+        stats = ds18b20_stats(i);
+        rom = ds18b20_rom(i);
+        
+        p = msg;
+        p += fmt_str(p, "TEMP");
+        p += fmt_uint(p, i);
+        p += fmt_char(p, ':');
+        for(b = ONEWIRE_ROM_SIZE - 1; b >= 0; b--) {
+            p += fmt_hex8(p, rom[b]);
+        }
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, ds18b20_resolution(i));
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->reads_ok);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->crc_errors);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->no_response);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->retries);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->failed_rounds);
+        fmt_str(p, "\r\n");
+        uart_send_response(msg);
+    }
+}
+
+// 距离传感器诊断：DIST_DIAG:mask,i2c_err,dropped 后每个通道一行
+// DISTn:addr,state,samples,range_err,bus_err,reinits
+void process_dist_diag(void) {
+    char msg[96];
+    char* p;
+    const Vl6180xHealth* health;
+    uint8 ch;
+    
+    p = msg;
+    p += fmt_str(p, "DIST_DIAG:");
+    p += fmt_hex8(p, vl6180x_channel_mask());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, i2c_bus_errors());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, vl6180x_dropped());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, vl6180x_als_integration_ms());
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        health = vl6180x_health(ch);
+        
+        p = msg;
+        p += fmt_str(p, "DIST");
+        p += fmt_uint(p, ch);
+        p += fmt_char(p, ':');
+        p += fmt_hex8(p, vl6180x_channel_address(ch));
+        p += fmt_char(p, ',');
+        p += fmt_str(p, vl6180x_channel_state(ch));
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, health->samples);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, health->range_errors);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, health->bus_errors);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, health->reinits);
+        fmt_str(p, "\r\n");
+        uart_send_response(msg);
+    }
+}
+
+// 各传感器的采样间隔：SCAN_RATE 列出，SCAN_RATE:sensor,ms 修改
+// D = 距离（VL6180X测量间隔，10ms取整，修改时重新初始化传感器），T = 温度（两轮转换之间的间隔），
+// C = 电容（单次测量间隔，每16次输出一个值）
+void process_scan_rate(const char* params) {
+    const char* p;
+    uint32 ms;
+    uint8 result;
+    char sensor;
+    char msg[48];
+    char* out = msg;
+    
+    if(params == NULL) {
+        out += fmt_str(out, "SCAN_RATE:D,");
+        out += fmt_uint(out, vl6180x_period_ms());
+        out += fmt_str(out, ",T,");
+        out += fmt_uint(out, ds18b20_interval());
+        out += fmt_str(out, ",C,");
+        out += fmt_uint(out, capacitance_interval());
+        fmt_str(out, "\r\n");
+        uart_send_response(msg);
+        return;
+    }
+    
+    sensor = params[0];
+    if(sensor == '\0' || params[1] != ',') {
+        uart_send_response("ERROR:INVALID_SENSOR\r\n");
+        return;
+    }
+    p = params + 2;
+    result = parse_uint(&p, &ms);
+    if(result == PARSE_OK && *p != '\0') {
+        result = PARSE_ERR_EXTRA;
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    
+    switch(sensor) {
+        case 'D':
+            if(ms < 10 || ms > 2550) {
+                uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+                return;
+            }
+            // 异步重启各通道的连续测距，不重新初始化
+            if(vl6180x_set_period((uint16)ms) != VL6180X_OK) {
+                uart_send_response("ERROR:BUSY\r\n");
+                return;
+            }
+            break;
+        case 'T':
+            if(ms > DS18B20_IDLE_MS_MAX) {
+                uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+                return;
+            }
+            ds18b20_set_interval((uint16)ms);
+            break;
+        case 'C':
+            if(ms < 1 || ms > CAP_SAMPLE_INTERVAL_MAX_MS) {
+                uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+                return;
+            }
+            capacitance_set_interval((uint16)ms);
+            break;
+        default:
+            uart_send_response("ERROR:INVALID_SENSOR\r\n");
+            return;
+    }
+    uart_send_response("OK:SCAN_RATE\r\n");
+}
+
+// 滤波参数和统计：FILTER 列出各通道，FILTER:ch,window,alpha,threshold 修改参数
+// 通道 0..3 = 距离（阈值单位0.1mm），4 = 温度（0.01°C），5 = 电容（fF）；alpha 为Q15系数（32768 = 不平均）
+void process_filter(const char* params) {
+    int32 values[4];    // 通道, 窗口, 系数, 阈值
+    uint8 result;
+    uint8 ch;
+    FilterConfig config;
+    const FilterConfig* current;
+    const FilterStats* stats;
+    char msg[64];
+    char* out;
+    
+    if(params == NULL) {
+        for(ch = 0; ch < FILTER_CHANNELS; ch++) {
+            current = filter_config(ch);
+            stats = filter_stats(ch);
+            out = msg;
+            out += fmt_str(out, "FILTER:");
+            out += fmt_uint(out, ch);
+            out += fmt_char(out, ',');
+            out += fmt_uint(out, current->window);
+            out += fmt_char(out, ',');
+            out += fmt_uint(out, current->alpha_q15);
+            out += fmt_char(out, ',');
+            out += fmt_int(out, current->reject_threshold);
+            out += fmt_char(out, ',');
+            out += fmt_uint(out, stats->accepted);
+            out += fmt_char(out, ',');
+            out += fmt_uint(out, stats->rejected);
+            out += fmt_char(out, ',');
+            out += fmt_uint(out, stats->resets);
+            out += fmt_char(out, ',');
+            out += fmt_uint(out, filter_quality(ch));
+            fmt_str(out, "\r\n");
+            uart_send_response(msg);
+        }
+        return;
+    }
+    
+    result = parse_fixed_fields(params, values, 4, 0);
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    
+    if(values[0] < 0 || values[0] >= FILTER_CHANNELS) {
+        uart_send_response("ERROR:INVALID_CHANNEL\r\n");
+        return;
+    }
+    if(values[1] < 0 || values[1] > FILTER_MAX_WINDOW || values[2] < 0 || values[2] > (int32)FILTER_ALPHA_ONE) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    config.window = (uint8)values[1];
+    config.alpha_q15 = (uint16)values[2];
+    config.reject_threshold = values[3];
+    
+    result = filter_configure((uint8)values[0], &config);
+    if(result == FILTER_ERR_WINDOW) {
+        uart_send_response("ERROR:INVALID_WINDOW\r\n");
+        return;
+    }
+    if(result != FILTER_OK) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    uart_send_response("OK:FILTER\r\n");
+}
+
+// ============ 校准（异步） ============
+// 校准由测量样本驱动，命令只负责启动后立即返回；
+// housekeeping_task 检查状态，离开 RUNNING 后保存并回复结果。同一时刻只有一个校准
+#define CAL_PENDING_NONE        0
+#define CAL_PENDING_CAP         1
+#define CAL_PENDING_DIST        2
+
+static uint8 cal_pending = CAL_PENDING_NONE;
+static uint8 cal_pending_type = 0;
+static uint8 cal_pending_channel = 0;
+
+static void cap_cal_finish(void) {
+    char msg[48];
+    char* out = msg;
     
-    int_to_string_with_decimal(temp_str[0], dist1);
-    int_to_string_with_decimal(temp_str[1], dist2);
-    int_to_string_with_decimal(temp_str[2], dist3);
-    int_to_string_with_decimal(temp_str[3], dist4);
+    if(capacitance_calibration_status() != CAP_CAL_DONE) {
+        uart_send_response("ERROR:CAP_CAL_FAILED\r\n");
+        return;
+    }
     
-    float_to_string(temp_str[4], temp);
-    float_to_string(temp_str[5], angle);
-    float_to_string(temp_str[6], cap);
+    LOG_INFO(LOG_CAT_SENSOR, LOG_EVT_CAP_CALIB, cal_pending_type);
+    filter_reset(FILTER_CH_CAP);
+    if(cap_calib_save() != CAP_CALIB_OK) {
+        uart_send_response("ERROR:NVSTORE\r\n");
+        return;
+    }
+    
+    out += fmt_str(out, (cal_pending_type == CAP_CAL_ZERO) ? "OK:CAP_ZERO," : "OK:CAP_REF,");
+    out += fmt_uint(out, capacitance_stats()->last_ticks_x16);
+    fmt_str(out, "\r\n");
+    uart_send_response(msg);
+}
+
+static void dist_cal_finish(void) {
+    const Vl6180xCalibration* cal;
+    char msg[48];
+    char* out = msg;
     
-    sprintf(response, "SENSORS:%s,%s,%s,%s,%s,%s,%s\r\n",
-            temp_str[0], temp_str[1], temp_str[2], temp_str[3],
-            temp_str[4], temp_str[5], temp_str[6]);
+    if(vl6180x_calibration_status(cal_pending_channel) != VL6180X_CAL_DONE) {
+        uart_send_response("ERROR:DIST_CAL_FAILED\r\n");
+        return;
+    }
     
-    #if DEBUG_MODE
-    debug_print("Sending sensor data:");
-    debug_print(response);
-    #endif
+    LOG_INFO(LOG_CAT_SENSOR, LOG_EVT_DIST_CALIB, cal_pending_channel);
+    if(dist_calib_save() != DIST_CALIB_OK) {
+        uart_send_response("ERROR:NVSTORE\r\n");
+        return;
+    }
     
+    cal = vl6180x_calibration(cal_pending_channel);
+    out += fmt_str(out, (cal_pending_type == VL6180X_CAL_OFFSET) ? "OK:DIST_CAL_OFFSET," : "OK:DIST_CAL_XTALK,");
+    out += fmt_uint(out, cal_pending_channel);
+    out += fmt_char(out, ',');
+    if(cal_pending_type == VL6180X_CAL_OFFSET) {
+        out += fmt_int(out, cal->offset_mm);
+    } else {
+        out += fmt_uint(out, cal->crosstalk_rate);
+    }
+    fmt_str(out, "\r\n");
+    uart_send_response(msg);
+}
+
+// housekeeping_task 调用：进行中的校准结束时回复
+void calibration_poll(void) {
+    switch(cal_pending) {
+        case CAL_PENDING_CAP:
+            if(capacitance_calibration_status() == CAP_CAL_RUNNING) {
+                return;
+            }
+            cap_cal_finish();
+            break;
+        case CAL_PENDING_DIST:
+            if(vl6180x_calibration_status(cal_pending_channel) == VL6180X_CAL_RUNNING) {
+                return;
+            }
+            dist_cal_finish();
+            break;
+        default:
+            return;
+    }
+    cal_pending = CAL_PENDING_NONE;
+}
+
+// 电容零点/参考校准：CAP_ZERO（空载） / CAP_REF:pF（接入已知电容）
+// 使用下一个平均值，完成后保存并回复平均计时（1/16计数）
+void process_cap_cal(const char* params, uint8 type) {
+    int32 ref_ff = 0;
+    uint8 result;
+    
+    if(cal_pending != CAL_PENDING_NONE) {
+        uart_send_response("ERROR:BUSY\r\n");
+        return;
+    }
+    if(type == CAP_CAL_REF) {
+        result = parse_fixed_fields(params, &ref_ff, 1, 3);
+        if(result != PARSE_OK) {
+            send_parse_error(result);
+            return;
+        }
+    }
+    
+    result = capacitance_calibrate(type, ref_ff);
+    if(result == CAP_ERR_NO_SOURCE) {
+        uart_send_response("ERROR:CAP_NOT_AVAILABLE\r\n");
+        return;
+    }
+    if(result != CAP_OK) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    cal_pending = CAL_PENDING_CAP;
+    cal_pending_type = type;
+}
+
+// 温度漂移学习：CAP_BASELINE:1 开始（空载，让腔体温度变化），CAP_BASELINE:0 结束并拟合保存
+void process_cap_baseline(const char* params) {
+    const char* p = params;
+    uint32 enable;
+    uint8 result;
+    char msg[48];
+    char* out = msg;
+    
+    result = parse_uint(&p, &enable);
+    if(result == PARSE_OK && *p != '\0') {
+        result = PARSE_ERR_EXTRA;
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    
+    if(enable) {
+        if(capacitance_baseline_start() != CAP_OK) {
+            uart_send_response("ERROR:CAP_NOT_AVAILABLE\r\n");
+            return;
+        }
+        uart_send_response("OK:CAP_BASELINE_STARTED\r\n");
+        return;
+    }
+    
+    result = capacitance_baseline_finish();
+    if(result == CAP_ERR_STATE) {
+        uart_send_response("ERROR:CAP_BASELINE_NOT_STARTED\r\n");
+        return;
+    }
+    if(result != CAP_OK) {
+        uart_send_response("ERROR:CAP_BASELINE_SPAN\r\n");
+        return;
+    }
+    LOG_INFO(LOG_CAT_SENSOR, LOG_EVT_CAP_CALIB, capacitance_calibration()->tempco_ff);
+    if(cap_calib_save() != CAP_CALIB_OK) {
+        uart_send_response("ERROR:NVSTORE\r\n");
+        return;
+    }
+    
+    out += fmt_str(out, "OK:CAP_BASELINE,");
+    out += fmt_int(out, capacitance_calibration()->tempco_ff);
+    fmt_str(out, "\r\n");
+    uart_send_response(msg);
+}
+
+// 电容测量诊断：CAP_DIAG:有无测量源,计时次数,超时次数,最近平均计时
+// CAP_CAL:零点计时,参考计时,参考fF,零点温度,漂移fF/°C
+void process_cap_diag(void) {
+    const CapStats* stats = capacitance_stats();
+    const CapCalibration* cal = capacitance_calibration();
+    char msg[80];
+    char* p = msg;
+    
+    p += fmt_str(p, "CAP_DIAG:");
+    p += fmt_uint(p, capacitance_available());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, stats->measurements);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, stats->timeouts);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, stats->last_ticks_x16);
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    p = msg;
+    p += fmt_str(p, "CAP_CAL:");
+    p += fmt_uint(p, cal->zero_ticks_x16);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, cal->ref_ticks_x16);
+    p += fmt_char(p, ',');
+    p += fmt_int(p, cal->ref_ff);
+    p += fmt_char(p, ',');
+    p += fmt_fixed(p, cal->baseline_temp_x100, 2);
+    p += fmt_char(p, ',');
+    p += fmt_int(p, cal->tempco_ff);
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+}
+
+// 片上历史的平均距离：每个通道一行 DIST_AVG:ch,n,均值,方差（mm，mm²）
+// 指定通道时只输出该通道；历史未满或无有效样本时输出 NA
+void process_dist_avg(const char* params) {
+    const char* p = params;
+    uint32 index;
+    uint8 first = 0;
+    uint8 last = VL6180X_CHANNELS;
+    uint8 result;
+    uint8 ch;
+    Vl6180xAverage average;
+    char msg[48];
+    char* out;
+    
+    if(params != NULL) {
+        result = parse_uint(&p, &index);
+        if(result == PARSE_OK && *p != '\0') {
+            result = PARSE_ERR_EXTRA;
+        }
+        if(result != PARSE_OK) {
+            send_parse_error(result);
+            return;
+        }
+        if(index >= VL6180X_CHANNELS) {
+            uart_send_response("ERROR:INVALID_CHANNEL\r\n");
+            return;
+        }
+        first = (uint8)index;
+        last = first + 1;
+    }
+    
+    for(ch = first; ch < last; ch++) {
+        out = msg;
+        out += fmt_str(out, "DIST_AVG:");
+        out += fmt_uint(out, ch);
+        out += fmt_char(out, ',');
+        if(vl6180x_history_average(ch, &average) == VL6180X_OK) {
+            out += fmt_uint(out, average.count);
+            out += fmt_char(out, ',');
+            out += fmt_fixed(out, average.mean_x100, 2);
+            out += fmt_char(out, ',');
+            out += fmt_fixed(out, average.variance_x100, 2);
+        } else {
+            out += fmt_str(out, "NA");
+        }
+        fmt_str(out, "\r\n");
+        uart_send_response(msg);
+    }
+}
+
+// 偏移/串扰校准：DIST_CAL_OFFSET:ch[,mm] / DIST_CAL_XTALK:ch[,mm]
+// 目标放好后执行，采集约 VL6180X_CAL_SAMPLES 个测量周期，完成后保存并回复
+void process_dist_cal(const char* params, uint8 type) {
+    const char* p = params;
+    uint32 index;
+    uint32 target = 0;
+    uint8 result;
+    
+    if(cal_pending != CAL_PENDING_NONE) {
+        uart_send_response("ERROR:BUSY\r\n");
+        return;
+    }
+    result = parse_uint(&p, &index);
+    if(result == PARSE_OK && *p == ',') {
+        p++;
+        result = parse_uint(&p, &target);
+    }
+    if(result == PARSE_OK && *p != '\0') {
+        result = PARSE_ERR_EXTRA;
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    if(index >= VL6180X_CHANNELS) {
+        uart_send_response("ERROR:INVALID_CHANNEL\r\n");
+        return;
+    }
+    if(target > 255) {
+        uart_send_response("ERROR:INVALID_TARGET\r\n");
+        return;
+    }
+    
+    if(vl6180x_calibrate((uint8)index, type, (uint8)target) != VL6180X_OK) {
+        uart_send_response("ERROR:DIST_NOT_RUNNING\r\n");
+        return;
+    }
+    cal_pending = CAL_PENDING_DIST;
+    cal_pending_type = type;
+    cal_pending_channel = (uint8)index;
+}
+
+// 当前校准值：每个通道一行 DIST_CAL:ch,偏移mm,串扰（9.7定点MCPS），未校准的项输出 NA
+void process_dist_cal_show(void) {
+    const Vl6180xCalibration* cal;
+    uint8 ch;
+    char msg[48];
+    char* out;
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        cal = vl6180x_calibration(ch);
+        out = msg;
+        out += fmt_str(out, "DIST_CAL:");
+        out += fmt_uint(out, ch);
+        out += fmt_char(out, ',');
+        if(cal->flags & VL6180X_CALIB_OFFSET_VALID) {
+            out += fmt_int(out, cal->offset_mm);
+        } else {
+            out += fmt_str(out, "NA");
+        }
+        out += fmt_char(out, ',');
+        if(cal->flags & VL6180X_CALIB_CROSSTALK_VALID) {
+            out += fmt_uint(out, cal->crosstalk_rate);
+        } else {
+            out += fmt_str(out, "NA");
+        }
+        fmt_str(out, "\r\n");
+        uart_send_response(msg);
+    }
+}
+
+// ============ 运行参数 ============
+// 前缀:名称=值
+static void format_config(char* dst, const char* prefix, uint8 id) {
+    char* p = dst;
+    
+    p += fmt_str(p, prefix);
+    p += fmt_str(p, config_name(id));
+    p += fmt_char(p, '=');
+    p += fmt_fixed(p, config_get(id), config_decimals(id));
+    fmt_str(p, "\r\n");
+}
+
+// 修改后立即生效：高度按新的步数比例换算，舵机按新的脉宽和角度范围重新输出
+static void apply_config(void) {
+    current_height = (float)stepper_position / config_get(CFG_STEPS_PER_MM);
+    servo_set_angle(current_angle);
+}
+
+// CFG_GET：CFG_INFO:版本,来源(DEFAULTS/SAVED/MIGRATED),有未保存的修改,启动载入耗时us，
+// 然后每个参数一行 CFG:名称=值；CFG_GET:名称 只输出该参数
+void process_cfg_get(const char* params) {
+    static const char* const source_names[] = { "DEFAULTS", "SAVED", "MIGRATED" };
+    char msg[64];
+    char* p;
+    uint8 id;
+    
+    if(params != NULL) {
+        id = config_find(params);
+        if(id == CFG_INVALID) {
+            uart_send_response("ERROR:UNKNOWN_PARAM\r\n");
+            return;
+        }
+        format_config(msg, "CFG:", id);
+        uart_send_response(msg);
+        return;
+    }
+    
+    p = msg;
+    p += fmt_str(p, "CFG_INFO:");
+    p += fmt_uint(p, CONFIG_VERSION);
+    p += fmt_char(p, ',');
+    p += fmt_str(p, source_names[config_source()]);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, config_modified());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, config_load_us());
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    for(id = 0; id < CFG_COUNT; id++) {
+        format_config(msg, "CFG:", id);
+        uart_send_response(msg);
+    }
+}
+
+// CFG_SET:名称,值 修改RAM中的参数（CFG_SAVE 后重启仍有效），运动中不能修改
+void process_cfg_set(const char* params) {
+    char name[24];
+    const char* p = params;
+    uint8 len = 0;
+    uint8 id;
+    int32 value;
+    uint8 result;
+    char msg[64];
+    
+    while(*p != ',' && *p != '\0' && len < sizeof(name) - 1) {
+        name[len++] = *p++;
+    }
+    name[len] = '\0';
+    if(*p != ',') {
+        uart_send_response((*p == '\0') ? "ERROR:MISSING_PARAM\r\n" : "ERROR:UNKNOWN_PARAM\r\n");
+        return;
+    }
+    p++;
+    
+    id = config_find(name);
+    if(id == CFG_INVALID) {
+        uart_send_response("ERROR:UNKNOWN_PARAM\r\n");
+        return;
+    }
+    result = parse_fixed(&p, &value, config_decimals(id));
+    if(result == PARSE_OK && *p != '\0') {
+        result = PARSE_ERR_EXTRA;
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    if(motion_phase != MOTION_IDLE) {
+        uart_send_response("ERROR:BUSY\r\n");
+        return;
+    }
+    if(config_set(id, value) != CONFIG_OK) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    apply_config();
+    
+    format_config(msg, "OK:CFG:", id);
+    uart_send_response(msg);
+}
+
+// CFG_SAVE：写入闪存（数十毫秒，运动中不执行）
+void process_cfg_save(void) {
+    if(motion_phase != MOTION_IDLE) {
+        uart_send_response("ERROR:BUSY\r\n");
+        return;
+    }
+    if(config_save() != CONFIG_OK) {
+        uart_send_response("ERROR:NVSTORE\r\n");
+        return;
+    }
+    LOG_INFO(LOG_CAT_SYSTEM, LOG_EVT_CONFIG, CONFIG_VERSION);
+    uart_send_response("OK:CFG_SAVED\r\n");
+}
+
+// CFG_DEFAULTS：恢复编译时的默认值（只改RAM，CFG_SAVE 后覆盖保存的值）
+void process_cfg_defaults(void) {
+    if(motion_phase != MOTION_IDLE) {
+        uart_send_response("ERROR:BUSY\r\n");
+        return;
+    }
+    config_defaults();
+    apply_config();
+    uart_send_response("OK:CFG_DEFAULTS\r\n");
+}
+
+void process_stream(const char* params) {
+    const char* p = params;
+    const char* fields = NULL;
+    uint32 rate;
+    uint8 result;
+    
+    result = parse_uint(&p, &rate);
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    if(*p == ',') {
+        fields = p + 1;
+    }
+    
+    if(rate == 0) {
+        telemetry_stop();
+        LOG_INFO(LOG_CAT_COMM, LOG_EVT_STREAM_STOP, 0);
+        uart_send_response("OK:STREAM_STOPPED\r\n");
+        return;
+    }
+    
+    result = (rate > TELEMETRY_MAX_RATE_HZ) ? TELEMETRY_ERR_RATE : telemetry_start((uint16)rate, fields);
+    if(result == TELEMETRY_ERR_RATE) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    if(result == TELEMETRY_ERR_FIELD) {
+        uart_send_response("ERROR:INVALID_FIELDS\r\n");
+        return;
+    }
+    LOG_INFO(LOG_CAT_COMM, LOG_EVT_STREAM_START, rate);
+    uart_send_response("OK:STREAM_STARTED\r\n");
+}
+
+void process_set_baud(const char* params) {
+    char response[32];
+    char* p = response;
+    const char* cursor = params;
+    uint32 baud;
+    uint8 result;
+    
+    result = parse_uint(&cursor, &baud);
+    if(result == PARSE_OK && *cursor != '\0') {
+        result = PARSE_ERR_EXTRA;
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    
+    result = uart_baud_prepare(baud);
+    if(result == UART_BAUD_ERR_BUSY) {
+        uart_send_response("ERROR:BAUD_SWITCH_PENDING\r\n");
+        return;
+    }
+    if(result != UART_BAUD_OK) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    
+    // 以旧速率回复，发送完成后再切换
+    telemetry_stop();
+    p += fmt_str(p, "OK:SET_BAUD,");
+    p += fmt_uint(p, baud);
+    fmt_str(p, "\r\n");
+    uart_send_response(response);
+    uart_baud_switch();
+    LOG_INFO(LOG_CAT_COMM, LOG_EVT_BAUD_SWITCH, baud);
+}
+
+void process_baud_confirm(void) {
+    char response[32];
+    char* p = response;
+    
+    if(!uart_baud_confirm()) {
+        uart_send_response("ERROR:NO_BAUD_SWITCH_PENDING\r\n");
+        return;
+    }
+    p += fmt_str(p, "OK:BAUD_CONFIRMED,");
+    p += fmt_uint(p, uart_baud_current());
+    fmt_str(p, "\r\n");
     uart_send_response(response);
 }
 
+// 时钟同步：TIME_SYNC[:token] -> TIME:token,收到命令的us,发送应答前的us
+// PC记录发送和收到应答的本地时间，取往返时间最短的若干次估计偏移，
+// 多次同步的偏移做线性拟合得到漂移；us计数约71.6分钟回绕，同步间隔应远小于此
+void process_time_sync(const char* params) {
+    char response[48];
+    char* p = response;
+    const char* cursor = params;
+    uint32 token = 0;
+    uint8 result;
+    
+    if(params != NULL) {
+        result = parse_uint(&cursor, &token);
+        if(result == PARSE_OK && *cursor != '\0') {
+            result = PARSE_ERR_EXTRA;
+        }
+        if(result != PARSE_OK) {
+            send_parse_error(result);
+            return;
+        }
+    }
+    
+    p += fmt_str(p, "TIME:");
+    p += fmt_uint(p, token);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, cmd_rx_us);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, timebase_us());
+    fmt_str(p, "\r\n");
+    uart_send_response(response);
+}
+
+#if FMT_BENCHMARK
+#include <stdio.h>
+
+#define FMT_BENCH_RUNS  32
+
+// SysTick按系统时钟递减计数，单次测量必须小于一个重载周期(1ms)
+static uint32 systick_elapsed(uint32 start) {
+    uint32 now = CySysTickGetValue();
+    return (start >= now) ? (start - now) : (start + CySysTickGetReload() + 1u - now);
+}
+
+static void bench_report(const char* name, uint32 total_cycles) {
+    char msg[48];
+    char* p = msg;
+    p += fmt_str(p, "BENCH:");
+    p += fmt_str(p, name);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, total_cycles / FMT_BENCH_RUNS);
+    fmt_str(p, " cycles\r\n");
+    uart_send_response(msg);
+}
+
+void process_fmt_bench(void) {
+    char buffer[32];
+    volatile float value = -123.45f;
+    uint32 total;
+    uint32 start;
+    uint8 i;
+    
+    total = 0;
+    for(i = 0; i < FMT_BENCH_RUNS; i++) {
+        start = CySysTickGetValue();
+        fmt_float(buffer, value, 1);
+        total += systick_elapsed(start);
+    }
+    bench_report("fmt_float", total);
+    
+    total = 0;
+    for(i = 0; i < FMT_BENCH_RUNS; i++) {
+        start = CySysTickGetValue();
+        fmt_int(buffer, (int32)value);
+        total += systick_elapsed(start);
+    }
+    bench_report("fmt_int", total);
+    
+    total = 0;
+    for(i = 0; i < FMT_BENCH_RUNS; i++) {
+        start = CySysTickGetValue();
+        sprintf(buffer, "%d", (int)value);
+        total += systick_elapsed(start);
+    }
+    bench_report("sprintf_d", total);
+    
+    // 需要在链接选项中打开 Enable Float printf，否则输出为空
+    total = 0;
+    for(i = 0; i < FMT_BENCH_RUNS; i++) {
+        start = CySysTickGetValue();
+        sprintf(buffer, "%.1f", value);
+        total += systick_elapsed(start);
+    }
+    bench_report("sprintf_f", total);
+}
+#endif
+
+void process_log_level(const char* params) {
+    int32 values[2];
+    uint8 result;
+    
+    // 参数: level 或 level,categories
+    result = parse_fixed_fields(params, values, 2, 0);
+    if(result == PARSE_ERR_MISSING && strchr(params, ',') == NULL) {
+        result = parse_fixed_fields(params, values, 1, 0);
+        values[1] = log_get_categories();
+    }
+    if(result != PARSE_OK) {
+        send_parse_error(result);
+        return;
+    }
+    if(values[0] < LOG_LEVEL_OFF || values[0] > LOG_LEVEL_DEBUG ||
+       values[1] < 0 || values[1] > LOG_CAT_ALL) {
+        uart_send_response("ERROR:OUT_OF_RANGE\r\n");
+        return;
+    }
+    
+    log_set_level((uint8)values[0]);
+    log_set_categories((uint8)values[1]);
+    uart_send_response("OK\r\n");
+}
+
+void process_log_dump(void) {
+    char msg[48];
+    char* p = msg;
+    
+    p += fmt_str(p, "LOG_DUMP:");
+    p += fmt_uint(p, log_count());
+    p += fmt_str(p, ",dropped=");
+    p += fmt_uint(p, log_dropped());
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    while(log_count() > 0) {
+        log_drain_one();
+    }
+    uart_send_response("LOG_END\r\n");
+}
+
+// SLEEP:1/0 开关空闲睡眠（对比功耗或排查问题时关闭）
+void process_sleep(const char* params) {
+    if(strcmp(params, "1") == 0) {
+        sched_set_idle_sleep(1);
+    } else if(strcmp(params, "0") == 0) {
+        sched_set_idle_sleep(0);
+    } else {
+        uart_send_response("ERROR:INVALID_PARAM\r\n");
+        return;
+    }
+    uart_send_response(sched_idle_sleep() ? "OK:SLEEP_ON\r\n" : "OK:SLEEP_OFF\r\n");
+}
+
+// SLEEP_STATS：统计开始以来的 启用,时长ms,睡眠ms,睡眠占比%,睡眠次数
+// SLEEP_STATS:RESET 重新开始统计
+void process_sleep_stats(const char* params) {
+    SchedIdleStats stats;
+    char msg[80];
+    char* p = msg;
+    
+    if(params != NULL) {
+        if(strcmp(params, "RESET") != 0) {
+            uart_send_response("ERROR:INVALID_PARAM\r\n");
+            return;
+        }
+        sched_reset_idle_stats();
+        uart_send_response("OK:SLEEP_STATS_RESET\r\n");
+        return;
+    }
+    
+    sched_idle_stats(&stats);
+    p += fmt_str(p, "SLEEP:");
+    p += fmt_uint(p, sched_idle_sleep());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, stats.window_ms);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, stats.sleep_ms);
+    p += fmt_char(p, ',');
+    p += fmt_fixed(p, stats.sleep_permille, 1);
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, stats.sleeps);
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+}
+
+// TASKS：各任务的运行次数、平均/最长运行时间、最坏就绪延迟（us）
+// TASKS:RESET 清零统计
+void process_tasks(const char* params) {
+    char msg[80];
+    char* p;
+    const SchedStats* stats;
+    uint8 i;
+    
+    if(params != NULL) {
+        if(strcmp(params, "RESET") != 0) {
+            uart_send_response("ERROR:INVALID_PARAM\r\n");
+            return;
+        }
+        sched_reset_stats();
+        uart_send_response("OK:TASKS_RESET\r\n");
+        return;
+    }
+    
+    p = msg;
+    p += fmt_str(p, "TASKS:");
+    p += fmt_uint(p, sched_task_count());
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    for(i = 0; i < sched_task_count(); i++) {
+        stats = sched_stats(i);
+        
+        p = msg;
+        p += fmt_str(p, "TASK:");
+        p += fmt_str(p, stats->name);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->runs);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, (stats->runs > 0) ? stats->total_us / stats->runs : 0);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->max_run_us);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, stats->max_latency_us);
+        fmt_str(p, "\r\n");
+        uart_send_response(msg);
+    }
+}
+
+// PROFILE：PROFILE:测量点数,每微秒计数，然后每个测量点
+//   PROF:名称,次数,最短,平均,最长（计数）
+//   PROF_HIST:名称,k,桶k的次数,桶k+1的次数...（从第一个到最后一个非零桶，桶k为[2^k, 2^(k+1))计数）
+// PROFILE:RESET 清零统计
+void process_profile(const char* params) {
+    const ProfileSlot* slot;
+    char msg[192];
+    char* p;
+    uint8 i;
+    uint8 first;
+    uint8 last;
+    
+    if(params != NULL) {
+        if(strcmp(params, "RESET") != 0) {
+            uart_send_response("ERROR:INVALID_PARAM\r\n");
+            return;
+        }
+        profile_reset();
+        uart_send_response("OK:PROFILE_RESET\r\n");
+        return;
+    }
+    
+    p = msg;
+    p += fmt_str(p, "PROFILE:");
+    p += fmt_uint(p, profile_count());
+    p += fmt_char(p, ',');
+    p += fmt_uint(p, TIMEBASE_TICKS_PER_US);
+    fmt_str(p, "\r\n");
+    uart_send_response(msg);
+    
+    for(i = 0; i < profile_count(); i++) {
+        slot = profile_get(i);
+        
+        p = msg;
+        p += fmt_str(p, "PROF:");
+        p += fmt_str(p, slot->name);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, slot->count);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, (slot->count > 0) ? slot->min_ticks : 0);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, (slot->count > 0) ? (uint32)(slot->total_ticks / slot->count) : 0);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, slot->max_ticks);
+        fmt_str(p, "\r\n");
+        uart_send_response(msg);
+        
+        if(slot->count == 0) {
+            continue;
+        }
+        for(first = 0; first < PROFILE_BUCKETS - 1 && slot->histogram[first] == 0; first++) {
+        }
+        for(last = PROFILE_BUCKETS - 1; last > first && slot->histogram[last] == 0; last--) {
+        }
+        p = msg;
+        p += fmt_str(p, "PROF_HIST:");
+        p += fmt_str(p, slot->name);
+        p += fmt_char(p, ',');
+        p += fmt_uint(p, first);
+        for(; first <= last; first++) {
+            p += fmt_char(p, ',');
+            p += fmt_uint(p, slot->histogram[first]);
+        }
+        fmt_str(p, "\r\n");
+        uart_send_response(msg);
+    }
+}
+
 void process_command(char* cmd) {
     char* colon;
     char* params;
-    char debug_msg[128];
+    uint8 command = PROF_CMD_INVALID;
+    uint32 start = PROFILE_START();
     
-    sprintf(debug_msg, "Received command: [%s] (length: %d)", cmd, strlen(cmd));
-    debug_print(debug_msg);
+    LOG_DEBUG(LOG_CAT_CMD, LOG_EVT_CMD_RECEIVED, strlen(cmd));
     
     while(*cmd == ' ') cmd++;
     
@@ -796,22 +2047,22 @@ void process_command(char* cmd) {
     if(colon != NULL) {
         *colon = '\0';
         params = colon + 1;
-        sprintf(debug_msg, "Command: [%s], Params: [%s]", cmd, params);
-        debug_print(debug_msg);
     } else {
         params = NULL;
-        sprintf(debug_msg, "Command: [%s], No params", cmd);
-        debug_print(debug_msg);
     }
+    PROFILE_STOP(prof_parse, start);
     
     // 处理命令
     if(strcmp(cmd, "SET_HEIGHT") == 0 && params != NULL) {
+        command = PROF_CMD_SET_HEIGHT;
         process_set_height(params);
     }
     else if(strcmp(cmd, "INIT_HOME") == 0) {
+        command = PROF_CMD_INIT_HOME;
         process_init_home();
     }
     else if(strcmp(cmd, "CHECK_LIMIT") == 0) {
+        command = PROF_CMD_CHECK_LIMIT;
         if(read_limit_switch() == LIMIT_SWITCH_TRIGGERED) {
             uart_send_response("INFO:Limit switch is TRIGGERED\r\n");
         } else {
@@ -819,48 +2070,186 @@ void process_command(char* cmd) {
         }
     }
     else if(strcmp(cmd, "SET_ANGLE") == 0 && params != NULL) {
+        command = PROF_CMD_SET_ANGLE;
         process_set_angle(params);
     }
     else if(strcmp(cmd, "MOVE_TO") == 0 && params != NULL) {
+        command = PROF_CMD_MOVE_TO;
         process_move_to(params);
     }
     else if(strcmp(cmd, "STOP") == 0) {
+        command = PROF_CMD_STOP;
         process_stop();
     }
     else if(strcmp(cmd, "EMERGENCY_STOP") == 0) {
+        command = PROF_CMD_EMERGENCY_STOP;
         process_emergency_stop();
     }
     else if(strcmp(cmd, "HOME") == 0) {
+        command = PROF_CMD_HOME;
         process_home();
     }
     else if(strcmp(cmd, "GET_STATUS") == 0) {
+        command = PROF_CMD_GET_STATUS;
         process_get_status();
     }
     else if(strcmp(cmd, "GET_SENSORS") == 0) {
+        command = PROF_CMD_GET_SENSORS;
         process_get_sensors();
     }
+    else if(strcmp(cmd, "GET_TEMPS") == 0) {
+        command = PROF_CMD_GET_TEMPS;
+        process_get_temps();
+    }
+    else if(strcmp(cmd, "TEMP_SCAN") == 0) {
+        command = PROF_CMD_TEMP_SCAN;
+        process_temp_scan();
+    }
+    else if(strcmp(cmd, "TEMP_RES") == 0 && params != NULL) {
+        command = PROF_CMD_TEMP_RES;
+        process_temp_res(params);
+    }
+    else if(strcmp(cmd, "TEMP_DIAG") == 0) {
+        command = PROF_CMD_TEMP_DIAG;
+        process_temp_diag();
+    }
+    else if(strcmp(cmd, "DIST_DIAG") == 0) {
+        command = PROF_CMD_DIST_DIAG;
+        process_dist_diag();
+    }
+    else if(strcmp(cmd, "CAP_ZERO") == 0) {
+        command = PROF_CMD_CAP_ZERO;
+        process_cap_cal(params, CAP_CAL_ZERO);
+    }
+    else if(strcmp(cmd, "CAP_REF") == 0 && params != NULL) {
+        command = PROF_CMD_CAP_REF;
+        process_cap_cal(params, CAP_CAL_REF);
+    }
+    else if(strcmp(cmd, "CAP_BASELINE") == 0 && params != NULL) {
+        command = PROF_CMD_CAP_BASELINE;
+        process_cap_baseline(params);
+    }
+    else if(strcmp(cmd, "CAP_DIAG") == 0) {
+        command = PROF_CMD_CAP_DIAG;
+        process_cap_diag();
+    }
+    else if(strcmp(cmd, "SCAN_RATE") == 0) {
+        command = PROF_CMD_SCAN_RATE;
+        process_scan_rate(params);
+    }
+    else if(strcmp(cmd, "FILTER") == 0) {
+        command = PROF_CMD_FILTER;
+        process_filter(params);
+    }
+    else if(strcmp(cmd, "DIST_AVG") == 0) {
+        command = PROF_CMD_DIST_AVG;
+        process_dist_avg(params);
+    }
+    else if(strcmp(cmd, "DIST_CAL_OFFSET") == 0 && params != NULL) {
+        command = PROF_CMD_DIST_CAL_OFFSET;
+        process_dist_cal(params, VL6180X_CAL_OFFSET);
+    }
+    else if(strcmp(cmd, "DIST_CAL_XTALK") == 0 && params != NULL) {
+        command = PROF_CMD_DIST_CAL_XTALK;
+        process_dist_cal(params, VL6180X_CAL_CROSSTALK);
+    }
+    else if(strcmp(cmd, "DIST_CAL") == 0) {
+        command = PROF_CMD_DIST_CAL;
+        process_dist_cal_show();
+    }
+    else if(strcmp(cmd, "CFG_GET") == 0) {
+        command = PROF_CMD_CFG_GET;
+        process_cfg_get(params);
+    }
+    else if(strcmp(cmd, "CFG_SET") == 0 && params != NULL) {
+        command = PROF_CMD_CFG_SET;
+        process_cfg_set(params);
+    }
+    else if(strcmp(cmd, "CFG_SAVE") == 0) {
+        command = PROF_CMD_CFG_SAVE;
+        process_cfg_save();
+    }
+    else if(strcmp(cmd, "CFG_DEFAULTS") == 0) {
+        command = PROF_CMD_CFG_DEFAULTS;
+        process_cfg_defaults();
+    }
+    else if(strcmp(cmd, "STREAM") == 0 && params != NULL) {
+        command = PROF_CMD_STREAM;
+        process_stream(params);
+    }
+    else if(strcmp(cmd, "STREAM_STOP") == 0) {
+        command = PROF_CMD_STREAM_STOP;
+        telemetry_stop();
+        LOG_INFO(LOG_CAT_COMM, LOG_EVT_STREAM_STOP, 0);
+        uart_send_response("OK:STREAM_STOPPED\r\n");
+    }
+    else if(strcmp(cmd, "SET_BAUD") == 0 && params != NULL) {
+        command = PROF_CMD_SET_BAUD;
+        process_set_baud(params);
+    }
+    else if(strcmp(cmd, "BAUD_OK") == 0) {
+        command = PROF_CMD_BAUD_OK;
+        process_baud_confirm();
+    }
+    else if(strcmp(cmd, "TIME_SYNC") == 0) {
+        command = PROF_CMD_TIME_SYNC;
+        process_time_sync(params);
+    }
+#if FMT_BENCHMARK
+    else if(strcmp(cmd, "FMT_BENCH") == 0) {
+        command = PROF_CMD_FMT_BENCH;
+        process_fmt_bench();
+    }
+#endif
     else if(strcmp(cmd, "TEST") == 0) {
-        debug_print("TEST command received - system is responding");
+        command = PROF_CMD_TEST;
+        LOG_INFO(LOG_CAT_CMD, LOG_EVT_CMD_TEST, 0);
         uart_send_response("TEST_OK:System is working\r\n");
     }
     else if(strcmp(cmd, "ECHO") == 0 && params != NULL) {
-        char echo_response[128];
-        sprintf(echo_response, "ECHO:%s\r\n", params);
-        uart_send_response(echo_response);
+        command = PROF_CMD_ECHO;
+        uart_send_response("ECHO:");
+        uart_send_response(params);
+        uart_send_response("\r\n");
     }
     else if(strcmp(cmd, "VERSION") == 0) {
+        command = PROF_CMD_VERSION;
         uart_send_response("VERSION:CDC_Control_v1.0\r\n");
     }
     else if(strcmp(cmd, "HELP") == 0) {
+        command = PROF_CMD_HELP;
         uart_send_response("Commands:\r\n");
         uart_send_response("Commands:\r\n");
         uart_send_response("  INIT_HOME - Initialize home position using limit switch\r\n");
         uart_send_response("  CHECK_LIMIT - Check limit switch status\r\n");
-        uart_send_response("  GET_STATUS - Get system status\r\n");
-        uart_send_response("  GET_SENSORS - Get sensor readings\r\n");
+        uart_send_response("  GET_STATUS - Get system status and time (us)\r\n");
+        uart_send_response("  GET_SENSORS - Latest sensor snapshot: values, quality, sequence, ages, sample times\r\n");
+        uart_send_response("  SCAN_RATE[:sensor,ms] - Show/set sampling interval (D,T,C)\r\n");
+        uart_send_response("  GET_TEMPS - Get all DS18B20 temperatures\r\n");
+        uart_send_response("  TEMP_SCAN - Search 1-Wire bus for DS18B20 sensors\r\n");
+        uart_send_response("  TEMP_RES:bits[,index] - Set DS18B20 resolution 9-12 bit\r\n");
+        uart_send_response("  TEMP_DIAG - 1-Wire error counters per sensor\r\n");
+        uart_send_response("  DIST_DIAG - VL6180X state and error counters per channel\r\n");
+        uart_send_response("  CAP_ZERO - Capacitance zero calibration (empty fixture)\r\n");
+        uart_send_response("  CAP_REF:pF - Capacitance scale calibration with reference capacitor\r\n");
+        uart_send_response("  CAP_BASELINE:1/0 - Start/finish learning capacitance drift vs temperature\r\n");
+        uart_send_response("  CAP_DIAG - Capacitance counters and calibration\r\n");
+        uart_send_response("  FILTER[:ch,window,alpha,threshold] - Show/set median+EMA filter\r\n");
+        uart_send_response("  DIST_AVG[:ch] - Mean and variance of on-chip range history\r\n");
+        uart_send_response("  DIST_CAL_OFFSET:ch[,mm] - Offset calibration (white target, 50mm)\r\n");
+        uart_send_response("  DIST_CAL_XTALK:ch[,mm] - Crosstalk calibration (black target, 100mm)\r\n");
+        uart_send_response("  DIST_CAL - Show stored distance calibration\r\n");
+        uart_send_response("  CFG_GET[:name] - Show motion/servo/homing parameters\r\n");
+        uart_send_response("  CFG_SET:name,value - Change a parameter (effective now, not saved)\r\n");
+        uart_send_response("  CFG_SAVE - Save parameters to flash\r\n");
+        uart_send_response("  CFG_DEFAULTS - Restore built-in parameter defaults (not saved)\r\n");
         uart_send_response("  SET_HEIGHT:value - Set target height\r\n");
         uart_send_response("  SET_ANGLE:value - Set target angle\r\n");
         uart_send_response("  MOVE_TO:height,angle - Move to position\r\n");
+        uart_send_response("  STREAM:rate,fields - Push data at rate Hz (fields: S,H,A,D,T,C,L,U)\r\n");
+        uart_send_response("  STREAM_STOP - Stop data streaming\r\n");
+        uart_send_response("  SET_BAUD:rate - Switch UART rate, confirm with BAUD_OK\r\n");
+        uart_send_response("  TIME_SYNC[:token] - Reply receive/send time (us) for clock offset/drift\r\n");
         uart_send_response("  HOME - Return to home position\r\n");
         uart_send_response("  STOP - Stop current movement\r\n");
         uart_send_response("  EMERGENCY_STOP - Emergency stop\r\n");
@@ -868,26 +2257,184 @@ void process_command(char* cmd) {
         uart_send_response("  ECHO:text - Echo back text\r\n");
         uart_send_response("  VERSION - Get version\r\n");
         uart_send_response("  DEBUG_ON/DEBUG_OFF - Toggle debug\r\n");
+        uart_send_response("  LOG_LEVEL:level[,categories] - Set log level 0-4 and category mask\r\n");
+        uart_send_response("  LOG_DUMP - Print and clear buffered log records\r\n");
+        uart_send_response("  TASKS[:RESET] - Per-task runs, avg/max run time, worst latency (us)\r\n");
+        uart_send_response("  SLEEP:1/0 - Enable/disable CPU sleep when idle\r\n");
+        uart_send_response("  SLEEP_STATS[:RESET] - Time and percentage spent asleep\r\n");
+        uart_send_response("  PROFILE[:RESET] - Per-command/phase count, min/mean/max and log2 histogram (ticks)\r\n");
     }
     else if(strcmp(cmd, "DEBUG_ON") == 0) {
-        #undef DEBUG_MODE
-        #define DEBUG_MODE 1
+        command = PROF_CMD_DEBUG_ON;
+        log_set_level(LOG_LEVEL_DEBUG);
+        log_set_auto_drain(1);
         uart_send_response("Debug mode ON\r\n");
     }
     else if(strcmp(cmd, "DEBUG_OFF") == 0) {
-        #undef DEBUG_MODE
-        #define DEBUG_MODE 0
+        command = PROF_CMD_DEBUG_OFF;
+        log_set_level(LOG_LEVEL_DEFAULT);
+        log_set_auto_drain(0);
         uart_send_response("Debug mode OFF\r\n");
     }
+    else if(strcmp(cmd, "LOG_LEVEL") == 0 && params != NULL) {
+        command = PROF_CMD_LOG_LEVEL;
+        process_log_level(params);
+    }
+    else if(strcmp(cmd, "LOG_DUMP") == 0) {
+        command = PROF_CMD_LOG_DUMP;
+        process_log_dump();
+    }
+    else if(strcmp(cmd, "TASKS") == 0) {
+        command = PROF_CMD_TASKS;
+        process_tasks(params);
+    }
+    else if(strcmp(cmd, "SLEEP") == 0 && params != NULL) {
+        command = PROF_CMD_SLEEP;
+        process_sleep(params);
+    }
+    else if(strcmp(cmd, "SLEEP_STATS") == 0) {
+        command = PROF_CMD_SLEEP_STATS;
+        process_sleep_stats(params);
+    }
+    else if(strcmp(cmd, "PROFILE") == 0) {
+        command = PROF_CMD_PROFILE;
+        process_profile(params);
+    }
     else {
-        sprintf(debug_msg, "Unknown command: [%s]", cmd);
-        debug_print(debug_msg);
+        LOG_WARN(LOG_CAT_CMD, LOG_EVT_CMD_UNKNOWN, strlen(cmd));
         uart_send_response("ERROR:INVALID_COMMAND\r\n");
     }
+    
+    // 整条命令（拆分、查找、处理和回复）计入所在分支的测量点
+    PROFILE_STOP(prof_command[command], start);
+}
+
+// ============ 任务 ============
+uint8 task_command = SCHED_INVALID;
+uint8 task_sensors = SCHED_INVALID;
+uint8 task_telemetry = SCHED_INVALID;
+
+// UART接收（及发送）中断结束时由生成代码调用（见 cyapicallbacks.h）
+void UART_SPI_UART_ISR_ExitCallback(void) {
+    sched_signal(task_command);
+}
+
+static void sensors_notify(void) {
+    sched_signal(task_sensors);
+}
+
+static void telemetry_notify(void) {
+    sched_signal(task_telemetry);
+}
+
+// 命令任务：由UART中断唤醒，每次最多执行一条完整命令，其余数据留到下一轮，
+// 期间其他就绪的任务可以先运行
+void command_task(void) {
+    char rx_char;
+    
+    while(UART_SpiUartGetRxBufferSize() > 0) {
+        rx_char = UART_UartGetChar();
+        
+        if(rx_char == '\n' || rx_char == '\r') {
+            if(cmd_index > 0) {
+                cmd_rx_us = timebase_us();
+                cmd_buffer[cmd_index] = '\0';
+                process_command(cmd_buffer);
+                memset(cmd_buffer, 0, CMD_BUFFER_SIZE);
+                cmd_index = 0;
+                if(UART_SpiUartGetRxBufferSize() > 0) {
+                    sched_signal(task_command);
+                }
+                return;
+            }
+        }
+        else if(cmd_index < CMD_BUFFER_SIZE - 1) {
+            cmd_buffer[cmd_index++] = rx_char;
+            cmd_buffer[cmd_index] = '\0';
+        }
+    }
+}
+
+// 波特率确认超时、校准结果、空闲时输出缓存日志
+void housekeeping_task(void) {
+    calibration_poll();
+    
+    // 新波特率超时未确认，已恢复默认速率
+    if(uart_baud_poll()) {
+        char baud_msg[32];
+        char* p = baud_msg;
+        memset(cmd_buffer, 0, CMD_BUFFER_SIZE);
+        cmd_index = 0;
+        p += fmt_str(p, "INFO:BAUD_REVERTED,");
+        p += fmt_uint(p, uart_baud_default());
+        fmt_str(p, "\r\n");
+        uart_send_response(baud_msg);
+        LOG_WARN(LOG_CAT_COMM, LOG_EVT_BAUD_REVERTED, uart_baud_default());
+    }
+    
+    // 链路空闲（无接收、无待发送、无半条命令）时输出缓存日志
+    if(log_get_auto_drain() && cmd_index == 0 &&
+       UART_SpiUartGetRxBufferSize() == 0 && UART_SpiUartGetTxBufferSize() == 0) {
+        log_drain_one();
+    }
+}
+
+void telemetry_task(void) {
+    uint32 start = PROFILE_START();
+    
+    telemetry_poll();
+    PROFILE_STOP(prof_telemetry, start);
+}
+
+void heartbeat_task(void) {
+    LOG_DEBUG(LOG_CAT_SYSTEM, LOG_EVT_HEARTBEAT, timebase_ms() / 1000u);
+}
+
+// 按优先级注册：运动和命令最先，日志输出最后
+void tasks_init(void) {
+    sched_init();
+    task_motion = sched_add("MOTION", motion_task, 0);
+    task_command = sched_add("COMMAND", command_task, 0);
+    task_sensors = sched_add("SENSORS", sensors_poll, SENSOR_TASK_MS);
+    task_telemetry = sched_add("TELEMETRY", telemetry_task, 0);
+    sched_add("HOUSEKEEPING", housekeeping_task, HOUSEKEEPING_TASK_MS);
+    sched_add("HEARTBEAT", heartbeat_task, HEARTBEAT_MS);
+    
+    stepper_init(motion_notify);
+    i2c_bus_set_notify(sensors_notify);
+    telemetry_set_notify(telemetry_notify);
 }
 
 // ============ 初始化函数 ============
 void system_init(void) {
+    uint8 result;
+    uint8 i;
+    
+    // 启动1ms时间基准和微秒计数（Timer_1us）
+    timebase_init();
+    
+    // 初始化日志缓冲区
+    log_init();
+    
+    // 固定的耗时测量点和每个命令的测量点
+    profile_init();
+    prof_parse = profile_slot("PARSE");
+    prof_tx = profile_slot("TX");
+    prof_dist = profile_slot("SENSOR_DIST");
+    prof_temp = profile_slot("SENSOR_TEMP");
+    prof_cap = profile_slot("SENSOR_CAP");
+    prof_telemetry = profile_slot("TELEMETRY");
+    for(i = 0; i < PROF_CMD_COUNT; i++) {
+        prof_command[i] = profile_slot(prof_command_names[i]);
+    }
+    
+    // 运行参数（舵机脉宽、步进和回零参数）最先载入，后面的初始化使用保存的值
+    nvstore_init();
+    result = config_load();
+    if(result == CONFIG_ERR_CRC || result == CONFIG_ERR_RANGE) {
+        LOG_WARN(LOG_CAT_SYSTEM, LOG_EVT_CONFIG, result);
+    }
+    
     // 初始化步进电机
     Pin_STEP_Write(0);
     Pin_DIR_Write(0);
@@ -897,8 +2444,39 @@ void system_init(void) {
     PWM_Servo_Start();
     servo_set_angle(0.0);  // 归中
     
-    // 初始化I2C（距离传感器）
-    I2C_Distance_Start();
+    // 初始化I2C（距离传感器），切换到400kHz
+    i2c_bus_init();
+    
+    // 初始化遥测推送（SysTick定时）
+    telemetry_init();
+    
+    // 记录上电默认波特率
+    uart_baud_init();
+    
+    // 距离/温度滤波器默认参数，GET_SENSORS 使用的快照
+    filter_init();
+    snapshot_init();
+    
+    // 温度传感器后台转换
+    ds18b20_init();
+    
+    // 保存的距离校准值在传感器初始化时写入
+    if(dist_calib_load() == DIST_CALIB_ERR_CRC) {
+        LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_DIST_CALIB, DIST_CALIB_ERR_CRC);
+    }
+    
+    // 电容测量：RC充电计时（使用timebase启动的Timer_1us计数器），没有测量电路时读数为NA
+    if(cap_calib_load() == CAP_CALIB_ERR_CRC) {
+        LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_CAP_CALIB, CAP_CALIB_ERR_CRC);
+    }
+    capacitance_init(cap_rc_init(), timebase_ms());
+    
+    // 距离传感器：分配地址后四路同时连续测距，缺少的通道记录日志
+    if(vl6180x_init(VL6180X_PERIOD_MS_DEFAULT) != VL6180X_OK) {
+        LOG_ERROR(LOG_CAT_SENSOR, LOG_EVT_DIST_INIT_FAILED, 0);
+    } else if(vl6180x_channel_mask() != (1u << VL6180X_CHANNELS) - 1u) {
+        LOG_WARN(LOG_CAT_SENSOR, LOG_EVT_DIST_INIT_FAILED, vl6180x_channel_mask());
+    }
     
     CyDelay(100);
     
@@ -907,15 +2485,14 @@ void system_init(void) {
     target_height = 0.0;
     target_angle = 0.0;
     system_status = STATUS_READY;
+    
+    // 运动、命令、传感器采集和遥测作为调度任务运行
+    tasks_init();
 }
 
 
 // ============ 主函数 ============
 int main(void) {
-    char rx_char;
-    uint32_t loop_counter = 0;
-    uint32_t last_heartbeat = 0;
-    
     CyGlobalIntEnable;
     
     // 启动UART
@@ -929,63 +2506,19 @@ int main(void) {
     uart_print("=====================================\r\n");
     uart_print("CDC Control System v1.0\r\n");
     uart_print("Debug Mode: ");
-    #if DEBUG_MODE
-    uart_print("ON\r\n");
-    #else
-    uart_print("OFF\r\n");
-    #endif
+    uart_print(log_get_auto_drain() ? "ON\r\n" : "OFF\r\n");
     uart_print("Type 'HELP' for command list\r\n");
     uart_print("Ready for commands\r\n");
+    LOG_INFO(LOG_CAT_SYSTEM, LOG_EVT_BOOT, 0);
     uart_print("=====================================\r\n");
     
 
+    // 启动前已收到的数据
+    sched_signal(task_command);
+    
+    // 没有就绪的任务时CPU睡眠，由中断唤醒
     for(;;) {
-
-        if(UART_SpiUartGetRxBufferSize() > 0) {
-            rx_char = UART_UartGetChar();
-            
-
-            #if DEBUG_MODE
-            if(rx_char >= 32 && rx_char <= 126) {  // 可打印字符
-                char debug_char[32];
-                sprintf(debug_char, "[RX: '%c' (0x%02X)]", rx_char, rx_char);
-                debug_print(debug_char);
-            } else if(rx_char == '\r') {
-                debug_print("[RX: CR (0x0D)]");
-            } else if(rx_char == '\n') {
-                debug_print("[RX: LF (0x0A)]");
-            }
-            #endif
-            
-            if(rx_char == '\n' || rx_char == '\r') {
-                if(cmd_index > 0) {
-                    cmd_buffer[cmd_index] = '\0';
-                    
-                    #if DEBUG_MODE
-                    char debug_cmd[128];
-                    sprintf(debug_cmd, "Command buffer: [%s]", cmd_buffer);
-                    debug_print(debug_cmd);
-                    #endif
-                    
-                    process_command(cmd_buffer);
-                    memset(cmd_buffer, 0, CMD_BUFFER_SIZE);
-                    cmd_index = 0;
-                }
-            }
-            else if(cmd_index < CMD_BUFFER_SIZE - 1) {
-                cmd_buffer[cmd_index++] = rx_char;
-                cmd_buffer[cmd_index] = '\0';
-            }
-        }
-        
-        loop_counter++;
-        if(loop_counter - last_heartbeat > 5000000) {
-            #if DEBUG_MODE
-            debug_print("System heartbeat - alive");
-            #endif
-            last_heartbeat = loop_counter;
-        }
-        
-        CyDelay(1);
+        sched_run();
+        sched_idle();
     }
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+/*
+ * nvstore.c - 非易失存储（cy_em_eeprom，闪存模拟EEPROM，带磨损均衡）
+ */
+
+#include "nvstore.h"
+
+// 存储区按闪存行对齐，位于用户闪存中（链接时与代码一起分配）
+CY_ALIGN(CY_EM_EEPROM_FLASH_SIZEOF_ROW)
+static const uint8 nvstore_storage[CY_EM_EEPROM_GET_PHYSICAL_SIZE(NVSTORE_SIZE, NVSTORE_WEAR_LEVELING, 0u)] = {0u};
+
+static cy_stc_eeprom_context_t nvstore_context;
+static uint8 initialized = 0;
+
+uint8 nvstore_init(void) {
+    cy_stc_eeprom_config_t config;
+    
+    config.eepromSize = NVSTORE_SIZE;
+    config.wearLevelingFactor = NVSTORE_WEAR_LEVELING;
+    config.redundantCopy = 0u;
+    config.blockingWrite = 1u;
+    config.userFlashStartAddr = (uint32)nvstore_storage;
+    
+    initialized = (Cy_Em_EEPROM_Init(&config, &nvstore_context) == CY_EM_EEPROM_SUCCESS);
+    return initialized ? NVSTORE_OK : NVSTORE_ERR_INIT;
+}
+
+uint8 nvstore_read(uint32 addr, void* data, uint32 size) {
+    if(!initialized) {
+        return NVSTORE_ERR_INIT;
+    }
+    if(addr + size > NVSTORE_SIZE) {
+        return NVSTORE_ERR_RANGE;
+    }
+    return (Cy_Em_EEPROM_Read(addr, data, size, &nvstore_context) == CY_EM_EEPROM_SUCCESS) ?
+           NVSTORE_OK : NVSTORE_ERR_FLASH;
+}
+
+uint8 nvstore_write(uint32 addr, const void* data, uint32 size) {
+    if(!initialized) {
+        return NVSTORE_ERR_INIT;
+    }
+    if(addr + size > NVSTORE_SIZE) {
+        return NVSTORE_ERR_RANGE;
+    }
+    return (Cy_Em_EEPROM_Write(addr, (void*)data, size, &nvstore_context) == CY_EM_EEPROM_SUCCESS) ?
+           NVSTORE_OK : NVSTORE_ERR_FLASH;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,36 @@
+/*
+ * nvstore.h - 非易失存储（cy_em_eeprom，闪存模拟EEPROM，带磨损均衡）
+ *
+ * 逻辑空间按固定地址划分给各模块，每个模块自己负责记录格式和校验。
+ * 写入会擦写闪存行，耗时数十毫秒，只在保存命令中调用。
+ */
+
+#ifndef NVSTORE_H
+#define NVSTORE_H
+
+#include "project.h"
+
+#define NVSTORE_SIZE                256u    // 逻辑字节数，必须是半个闪存行的整数倍
+#define NVSTORE_WEAR_LEVELING       4u
+
+// 逻辑地址分配
+#define NVSTORE_DIST_CALIB_ADDR     0u      // 距离传感器校准（dist_calib.c）
+#define NVSTORE_DIST_CALIB_SIZE     32u
+#define NVSTORE_CAP_CALIB_ADDR      32u     // 电容测量校准（cap_calib.c）
+#define NVSTORE_CAP_CALIB_SIZE      32u
+#define NVSTORE_CONFIG_ADDR         64u     // 运行参数（config.c）
+#define NVSTORE_CONFIG_SIZE         128u
+
+// 返回值
+#define NVSTORE_OK                  0
+#define NVSTORE_ERR_INIT            1
+#define NVSTORE_ERR_RANGE           2
+#define NVSTORE_ERR_FLASH           3
+
+uint8 nvstore_init(void);
+uint8 nvstore_read(uint32 addr, void* data, uint32 size);
+uint8 nvstore_write(uint32 addr, const void* data, uint32 size);
+
+#endif /* NVSTORE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,415 @@
+/*
+ * onewire.c - 1-Wire总线时序引擎（Timer_1us比较中断驱动）
+ *
+ * Timer_1us 改为自由运行的16位计数器（Clock_2 = 12MHz，周期0xFFFF），
+ * 每个阶段结束时在比较中断里翻转引脚并预约下一个比较点。
+ * 比较点在上一个比较点基础上累加，中断延迟不会累积到时隙长度上。
+ *
+ * 只有写1（6us低电平）和读时隙（3us低电平 + 第12us采样）太短，
+ * 无法靠中断往返完成，这两段在中断内用临界区忙等；
+ * 复位的480us、写0的60us以及各时隙的恢复时间都交给定时器。
+ */
+
+#include "onewire.h"
+#include <string.h>
+
+#define ONEWIRE_TICKS_PER_US    12u     // Clock_2 = 12MHz
+#define ONEWIRE_COUNTER_MASK    0xFFFFu
+
+// 阻塞等待的上限：最长的事务（复位 + 12字节写 + 9字节读）约13ms
+#define ONEWIRE_WAIT_TIMEOUT_US 20000u
+#define ONEWIRE_WAIT_STEP_US    10u
+
+// Timer_1us(TCPWM CNT1)的中断输出未连接isr组件，直接安装向量；
+// CNT2 的中断号为 20（见 isr_STEP），CNT1 为 19
+#define ONEWIRE_TIMER_IRQ       19u
+#define ONEWIRE_TIMER_PRIORITY  0u      // 最高优先级，保证时隙边沿不被其他中断推迟
+
+// 时隙时序（us）
+#define OW_RESET_LOW_US         480
+#define OW_PRESENCE_SAMPLE_US   70
+#define OW_RESET_RECOVERY_US    410
+#define OW_WRITE1_LOW_US        6
+#define OW_WRITE1_RECOVERY_US   64
+#define OW_WRITE0_LOW_US        60
+#define OW_WRITE0_RECOVERY_US   10
+#define OW_READ_LOW_US          3
+#define OW_READ_SAMPLE_US       9       // 释放后到采样点
+#define OW_READ_RECOVERY_US     53
+#define OW_START_LEAD_US        5       // 启动事务到第一个比较点
+
+typedef enum {
+    OW_PHASE_IDLE,
+    OW_PHASE_RESET_LOW,
+    OW_PHASE_RESET_SAMPLE,
+    OW_PHASE_RESET_RECOVERY,
+    OW_PHASE_SLOT,
+    OW_PHASE_WRITE0_RELEASE
+} OneWirePhase;
+
+// ============ 事务状态（中断与主循环共享） ============
+static volatile uint8 txn_busy = 0;
+static volatile uint8 txn_status = ONEWIRE_OK;
+static volatile OneWirePhase phase = OW_PHASE_IDLE;
+
+static uint8 tx_buf[ONEWIRE_MAX_TX];
+static uint8 rx_buf[ONEWIRE_MAX_RX];
+static uint8 rx_count = 0;
+static uint16 tx_bits = 0;
+static uint16 total_bits = 0;
+static uint16 bit_index = 0;
+static uint8 presence = 0;
+static uint16 next_compare = 0;
+
+// ============ 定时器辅助 ============
+static void schedule_us(uint16 us) {
+    next_compare = (uint16)((next_compare + us * ONEWIRE_TICKS_PER_US) & ONEWIRE_COUNTER_MASK);
+    Timer_1us_WriteCompare(next_compare);
+}
+
+static void finish(uint8 status) {
+    Timer_1us_SetInterruptMode(Timer_1us__INTR_MASK_NONE);
+    phase = OW_PHASE_IDLE;
+    txn_status = status;
+    txn_busy = 0;
+}
+
+// 执行当前位的时隙，或在全部位完成后结束事务
+static void run_slot(void) {
+    uint8 int_state;
+    uint8 bit;
+    
+    if(bit_index >= total_bits) {
+        finish(ONEWIRE_OK);
+        return;
+    }
+    
+    if(bit_index < tx_bits) {
+        bit = (tx_buf[bit_index >> 3] >> (bit_index & 7u)) & 0x01u;  // 低位先发
+        
+        if(bit) {
+            int_state = CyEnterCriticalSection();
+            OneWire_Pin_Write(0);
+            CyDelayUs(OW_WRITE1_LOW_US);
+            OneWire_Pin_Write(1);
+            CyExitCriticalSection(int_state);
+            schedule_us(OW_WRITE1_LOW_US + OW_WRITE1_RECOVERY_US);
+        } else {
+            OneWire_Pin_Write(0);
+            schedule_us(OW_WRITE0_LOW_US);
+            phase = OW_PHASE_WRITE0_RELEASE;
+        }
+    } else {
+        uint16 rx_bit = bit_index - tx_bits;
+        
+        int_state = CyEnterCriticalSection();
+        OneWire_Pin_Write(0);
+        CyDelayUs(OW_READ_LOW_US);
+        OneWire_Pin_Write(1);
+        CyDelayUs(OW_READ_SAMPLE_US);
+        bit = OneWire_Pin_Read() ? 1 : 0;
+        CyExitCriticalSection(int_state);
+        
+        if(bit) {
+            rx_buf[rx_bit >> 3] |= (uint8)(1u << (rx_bit & 7u));
+        }
+        schedule_us(OW_READ_LOW_US + OW_READ_SAMPLE_US + OW_READ_RECOVERY_US);
+    }
+    
+    bit_index++;
+}
+
+// ============ 比较中断 ============
+static CY_ISR(onewire_timer_isr) {
+    Timer_1us_ClearInterrupt(Timer_1us_INTR_MASK_CC_MATCH);
+    
+    switch(phase) {
+        case OW_PHASE_RESET_LOW:
+            OneWire_Pin_Write(1);
+            schedule_us(OW_PRESENCE_SAMPLE_US);
+            phase = OW_PHASE_RESET_SAMPLE;
+            break;
+            
+        case OW_PHASE_RESET_SAMPLE:
+            presence = (OneWire_Pin_Read() == 0) ? 1 : 0;
+            schedule_us(OW_RESET_RECOVERY_US);
+            phase = OW_PHASE_RESET_RECOVERY;
+            break;
+            
+        case OW_PHASE_RESET_RECOVERY:
+            if(!presence) {
+                finish(ONEWIRE_ERR_NO_PRESENCE);
+                break;
+            }
+            phase = OW_PHASE_SLOT;
+            run_slot();
+            break;
+            
+        case OW_PHASE_WRITE0_RELEASE:
+            OneWire_Pin_Write(1);
+            schedule_us(OW_WRITE0_RECOVERY_US);
+            phase = OW_PHASE_SLOT;
+            break;
+            
+        case OW_PHASE_SLOT:
+            run_slot();
+            break;
+            
+        default:
+            finish(ONEWIRE_OK);
+            break;
+    }
+}
+
+// ============ 对外接口 ============
+void onewire_init(void) {
+    OneWire_Pin_Write(1);
+    
+    // 生成的配置是捕获模式（TC_COMP_CAP_MODE），不会产生比较匹配中断：
+    // 首次初始化后、使能前改为比较模式；已由 timebase_init() 启动时不重新使能，计数保持连续
+    if(Timer_1us_initVar == 0u) {
+        Timer_1us_Init();
+        Timer_1us_initVar = 1u;
+        Timer_1us_SetMode(Timer_1us_MODE_TIMER_COMPARE);
+        Timer_1us_WritePeriod(ONEWIRE_COUNTER_MASK);
+        Timer_1us_Enable();
+    } else {
+        Timer_1us_SetMode(Timer_1us_MODE_TIMER_COMPARE);
+    }
+    Timer_1us_SetInterruptMode(Timer_1us__INTR_MASK_NONE);
+    Timer_1us_ClearInterrupt(Timer_1us_INTR_MASK_CC_MATCH);
+    
+    CyIntSetVector(ONEWIRE_TIMER_IRQ, onewire_timer_isr);
+    CyIntSetPriority(ONEWIRE_TIMER_IRQ, ONEWIRE_TIMER_PRIORITY);
+    CyIntEnable(ONEWIRE_TIMER_IRQ);
+}
+
+// 以位为单位启动事务（Search ROM、转换完成查询需要单独的读写位）
+uint8 onewire_begin_bits(uint8 flags, const uint8* tx, uint16 tx_bit_count, uint16 rx_bit_count) {
+    uint8 tx_len = (uint8)((tx_bit_count + 7u) >> 3);
+    uint8 rx_len = (uint8)((rx_bit_count + 7u) >> 3);
+    
+    if(txn_busy) {
+        return ONEWIRE_ERR_BUSY;
+    }
+    if(tx_len > ONEWIRE_MAX_TX || rx_len > ONEWIRE_MAX_RX) {
+        return ONEWIRE_ERR_LENGTH;
+    }
+    
+    if(tx_len > 0) {
+        memcpy(tx_buf, tx, tx_len);
+    }
+    memset(rx_buf, 0, sizeof(rx_buf));
+    rx_count = rx_len;
+    tx_bits = tx_bit_count;
+    total_bits = tx_bit_count + rx_bit_count;
+    bit_index = 0;
+    presence = 0;
+    txn_status = ONEWIRE_OK;
+    txn_busy = 1;
+    
+    next_compare = (uint16)Timer_1us_ReadCounter();
+    Timer_1us_ClearInterrupt(Timer_1us_INTR_MASK_CC_MATCH);
+    
+    if(flags & ONEWIRE_TXN_RESET) {
+        phase = OW_PHASE_RESET_LOW;
+        OneWire_Pin_Write(0);
+        schedule_us(OW_RESET_LOW_US);
+    } else {
+        phase = OW_PHASE_SLOT;
+        schedule_us(OW_START_LEAD_US);
+    }
+    
+    Timer_1us_SetInterruptMode(Timer_1us_INTR_MASK_CC_MATCH);
+    
+    return ONEWIRE_OK;
+}
+
+// 启动一次事务，立即返回
+uint8 onewire_begin(uint8 flags, const uint8* tx, uint8 tx_len, uint8 rx_len) {
+    return onewire_begin_bits(flags, tx, (uint16)tx_len * 8u, (uint16)rx_len * 8u);
+}
+
+uint8 onewire_busy(void) {
+    return txn_busy;
+}
+
+// 事务结束后取结果，rx 可为NULL
+uint8 onewire_result(uint8* rx) {
+    if(txn_busy) {
+        return ONEWIRE_ERR_BUSY;
+    }
+    if(rx != NULL && rx_count > 0) {
+        memcpy(rx, rx_buf, rx_count);
+    }
+    return txn_status;
+}
+
+// 中止进行中的事务并释放总线，结果为 ONEWIRE_ERR_TIMEOUT
+void onewire_abort(void) {
+    uint8 int_state = CyEnterCriticalSection();
+    
+    if(txn_busy) {
+        finish(ONEWIRE_ERR_TIMEOUT);
+        OneWire_Pin_Write(1);
+    }
+    CyExitCriticalSection(int_state);
+}
+
+// 等待事务结束，超时（定时器不工作或总线卡死）则中止，返回事务结果
+// 用CyDelayUs计时，不依赖 Timer_1us
+uint8 onewire_wait(void) {
+    uint32 waited = 0;
+    
+    while(txn_busy) {
+        if(waited >= ONEWIRE_WAIT_TIMEOUT_US) {
+            onewire_abort();
+            break;
+        }
+        CyDelayUs(ONEWIRE_WAIT_STEP_US);
+        waited += ONEWIRE_WAIT_STEP_US;
+    }
+    return txn_status;
+}
+
+// ============ 等待完成的简化接口 ============
+uint8 onewire_reset(void) {
+    if(onewire_begin(ONEWIRE_TXN_RESET, NULL, 0, 0) != ONEWIRE_OK) {
+        return 0;
+    }
+    return (onewire_wait() == ONEWIRE_OK) ? 1 : 0;
+}
+
+void onewire_write_byte(uint8 data) {
+    if(onewire_begin(0, &data, 1, 0) != ONEWIRE_OK) {
+        return;
+    }
+    onewire_wait();
+}
+
+uint8 onewire_read_byte(void) {
+    uint8 data = 0;
+    
+    if(onewire_begin(0, NULL, 0, 1) != ONEWIRE_OK) {
+        return 0;
+    }
+    if(onewire_wait() == ONEWIRE_OK) {
+        onewire_result(&data);
+    }
+    return data;
+}
+
+// ============ CRC-8 ============
+// Dallas/Maxim CRC-8（x^8 + x^5 + x^4 + 1，低位先入），查表法
+static const uint8 onewire_crc8_table[256] = {
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+    0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+    0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+    0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+    0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+    0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+    0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+    0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+    0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+    0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+    0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+    0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+    0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+    0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+    0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+
+// 对含CRC字节的完整数据计算结果为0
+uint8 onewire_crc8(const uint8* data, uint8 len) {
+    uint8 crc = 0;
+    
+    while(len--) {
+        crc = onewire_crc8_table[crc ^ *data++];
+    }
+    return crc;
+}
+
+// ============ Search ROM ============
+// 读出一位及其补码（两个读时隙）
+static uint8 read_bit_pair(void) {
+    uint8 bits = 0;
+    
+    if(onewire_begin_bits(0, NULL, 0, 2) != ONEWIRE_OK || onewire_wait() != ONEWIRE_OK) {
+        return 0x03;    // 与无设备应答相同，搜索结束
+    }
+    onewire_result(&bits);
+    return bits & 0x03u;
+}
+
+static void write_bit(uint8 bit) {
+    if(onewire_begin_bits(0, &bit, 1, 0) != ONEWIRE_OK) {
+        return;
+    }
+    onewire_wait();
+}
+
+// 逐位二叉搜索，每轮确定一个设备的ROM码，返回找到的设备数
+uint8 onewire_search(uint8 roms[][ONEWIRE_ROM_SIZE], uint8 max_devices) {
+    uint8 rom[ONEWIRE_ROM_SIZE];
+    uint8 count = 0;
+    uint8 last_discrepancy = 0;     // 上一轮最后一个选0的分歧位（1~64，0表示无）
+    uint8 last_zero;
+    uint8 bit_number;
+    uint8 pair;
+    uint8 direction;
+    uint8 byte_index;
+    uint8 mask;
+    
+    memset(rom, 0, sizeof(rom));
+    
+    while(count < max_devices) {
+        if(!onewire_reset()) {
+            break;
+        }
+        onewire_write_byte(ONEWIRE_CMD_SEARCH_ROM);
+        
+        last_zero = 0;
+        for(bit_number = 1; bit_number <= 64; bit_number++) {
+            byte_index = (uint8)((bit_number - 1u) >> 3);
+            mask = (uint8)(1u << ((bit_number - 1u) & 7u));
+            
+            // bit0 = 该位，bit1 = 补码
+            pair = read_bit_pair();
+            if(pair == 0x03) {
+                return count;   // 没有设备响应
+            }
+            
+            if(pair == 0x01 || pair == 0x02) {
+                direction = pair & 0x01u;   // 所有设备该位相同
+            } else if(bit_number < last_discrepancy) {
+                direction = (rom[byte_index] & mask) ? 1 : 0;   // 沿用上一轮的选择
+            } else {
+                direction = (bit_number == last_discrepancy) ? 1 : 0;
+            }
+            
+            if(pair == 0x00 && direction == 0) {
+                last_zero = bit_number;
+            }
+            
+            if(direction) {
+                rom[byte_index] |= mask;
+            } else {
+                rom[byte_index] &= (uint8)~mask;
+            }
+            write_bit(direction);
+        }
+        
+        memcpy(roms[count], rom, ONEWIRE_ROM_SIZE);
+        count++;
+        
+        last_discrepancy = last_zero;
+        if(last_discrepancy == 0) {
+            break;  // 已遍历全部分支
+        }
+    }
+    
+    return count;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,54 @@
+/*
+ * onewire.h - 1-Wire总线时序引擎（Timer_1us比较中断驱动）
+ *
+ * 一次事务 = 可选的复位/存在检测 + 写N字节 + 读M字节，全部在定时器中断中
+ * 逐时隙完成，时隙之间CPU可处理其他工作。
+ * onewire_begin() 启动事务后立即返回，用 onewire_busy() 查询是否完成；
+ * onewire_reset()/write_byte()/read_byte() 是等待完成的简化接口；
+ * 所有阻塞等待都经过 onewire_wait()，超时后中止事务，定时器或总线故障不会卡住MCU。
+ * onewire_search() 按 Search ROM 算法枚举总线上的全部设备（阻塞）。
+ */
+
+#ifndef ONEWIRE_H
+#define ONEWIRE_H
+
+#include "project.h"
+
+#define ONEWIRE_ROM_SIZE        8       // 64位ROM码
+#define ONEWIRE_MAX_TX          (ONEWIRE_ROM_SIZE + 5)  // Match ROM(1) + ROM(8) + 写暂存器(1) + 数据(3)
+#define ONEWIRE_MAX_RX          9       // DS18B20暂存器
+
+// ROM命令
+#define ONEWIRE_CMD_SEARCH_ROM  0xF0
+#define ONEWIRE_CMD_MATCH_ROM   0x55
+#define ONEWIRE_CMD_SKIP_ROM    0xCC
+
+// 事务标志
+#define ONEWIRE_TXN_RESET       0x01u   // 事务开始前先复位并检测存在脉冲
+
+// 返回值
+#define ONEWIRE_OK              0
+#define ONEWIRE_ERR_NO_PRESENCE 1
+#define ONEWIRE_ERR_BUSY        2
+#define ONEWIRE_ERR_LENGTH      3
+#define ONEWIRE_ERR_TIMEOUT     4       // 阻塞等待超时，事务已中止
+
+void onewire_init(void);
+
+uint8 onewire_begin(uint8 flags, const uint8* tx, uint8 tx_len, uint8 rx_len);
+uint8 onewire_begin_bits(uint8 flags, const uint8* tx, uint16 tx_bit_count, uint16 rx_bit_count);
+uint8 onewire_busy(void);
+uint8 onewire_result(uint8* rx);
+uint8 onewire_wait(void);
+void onewire_abort(void);
+
+uint8 onewire_reset(void);
+void onewire_write_byte(uint8 data);
+uint8 onewire_read_byte(void);
+
+uint8 onewire_search(uint8 roms[][ONEWIRE_ROM_SIZE], uint8 max_devices);
+uint8 onewire_crc8(const uint8* data, uint8 len);
+
+#endif /* ONEWIRE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,159 @@
+/*
+ * parse.c - 原地定点数参数解析
+ *
+ * 字段格式: [空格][+|-]数字[.数字][空格]，字段之间用逗号分隔。
+ * 超出 decimals 的小数位按下一位四舍五入。
+ */
+
+#include "parse.h"
+
+#define INT32_LIMIT     2147483647u
+
+static const char* skip_spaces(const char* p) {
+    while(*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+static uint8 is_digit(char c) {
+    return (c >= '0' && c <= '9') ? 1 : 0;
+}
+
+// 在 *magnitude 后追加一位数字，溢出时返回0
+static uint8 append_digit(uint32* magnitude, uint32 digit, uint32 limit) {
+    if(*magnitude > (limit - digit) / 10u) {
+        return 0;
+    }
+    *magnitude = *magnitude * 10u + digit;
+    return 1;
+}
+
+uint8 parse_fixed(const char** cursor, int32* value, uint8 decimals) {
+    const char* p;
+    const char* start;
+    uint32 magnitude = 0;
+    uint32 limit;
+    uint8 negative = 0;
+    uint8 digits = 0;
+    uint8 frac_digits = 0;
+
+    if(cursor == NULL || *cursor == NULL) {
+        return PARSE_ERR_MISSING;
+    }
+    if(decimals > PARSE_MAX_DECIMALS) {
+        decimals = PARSE_MAX_DECIMALS;
+    }
+
+    p = skip_spaces(*cursor);
+    start = p;
+
+    if(*p == '-') {
+        negative = 1;
+        p++;
+    } else if(*p == '+') {
+        p++;
+    }
+
+    // 负数可以多表示一个值
+    limit = negative ? (INT32_LIMIT + 1u) : INT32_LIMIT;
+
+    // 整数部分
+    while(is_digit(*p)) {
+        if(!append_digit(&magnitude, (uint32)(*p - '0'), limit)) {
+            return PARSE_ERR_OVERFLOW;
+        }
+        digits++;
+        p++;
+    }
+
+    // 小数部分
+    if(*p == '.') {
+        p++;
+        while(is_digit(*p)) {
+            if(frac_digits < decimals) {
+                if(!append_digit(&magnitude, (uint32)(*p - '0'), limit)) {
+                    return PARSE_ERR_OVERFLOW;
+                }
+                frac_digits++;
+            } else if(frac_digits == decimals) {
+                // 第一个多余的小数位用于四舍五入
+                if(*p >= '5') {
+                    if(magnitude == limit) {
+                        return PARSE_ERR_OVERFLOW;
+                    }
+                    magnitude++;
+                }
+                frac_digits++;
+            }
+            digits++;
+            p++;
+        }
+    }
+
+    if(digits == 0) {
+        // 只有符号或小数点
+        if(p != start) {
+            return PARSE_ERR_SYNTAX;
+        }
+        return (*p == '\0' || *p == ',') ? PARSE_ERR_MISSING : PARSE_ERR_SYNTAX;
+    }
+
+    // 补齐未写出的小数位
+    while(frac_digits < decimals) {
+        if(!append_digit(&magnitude, 0, limit)) {
+            return PARSE_ERR_OVERFLOW;
+        }
+        frac_digits++;
+    }
+
+    p = skip_spaces(p);
+    if(*p != '\0' && *p != ',') {
+        return PARSE_ERR_SYNTAX;
+    }
+
+    *value = negative ? (int32)((uint32)0 - magnitude) : (int32)magnitude;
+    *cursor = p;
+    return PARSE_OK;
+}
+
+uint8 parse_fixed_fields(const char* str, int32* values, uint8 count, uint8 decimals) {
+    const char* p = str;
+    uint8 i;
+    uint8 result;
+
+    if(str == NULL) {
+        return PARSE_ERR_MISSING;
+    }
+
+    for(i = 0; i < count; i++) {
+        if(i > 0) {
+            if(*p != ',') {
+                return PARSE_ERR_MISSING;
+            }
+            p++;
+        }
+        result = parse_fixed(&p, &values[i], decimals);
+        if(result != PARSE_OK) {
+            return result;
+        }
+    }
+
+    return (*p == '\0') ? PARSE_OK : PARSE_ERR_EXTRA;
+}
+
+uint8 parse_uint(const char** cursor, uint32* value) {
+    int32 parsed;
+    uint8 result = parse_fixed(cursor, &parsed, 0);
+
+    if(result != PARSE_OK) {
+        return result;
+    }
+    if(parsed < 0) {
+        return PARSE_ERR_SYNTAX;
+    }
+    *value = (uint32)parsed;
+    return PARSE_OK;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,28 @@
+/*
+ * parse.h - 原地定点数参数解析
+ * 直接遍历命令参数字符串，不复制、不使用atof/strtod
+ *
+ * 数值按 10^decimals 放大为int32返回，例如 decimals=2 时 "12.345" -> 1235
+ */
+
+#ifndef PARSE_H
+#define PARSE_H
+
+#include "project.h"
+
+#define PARSE_MAX_DECIMALS  4
+
+// 返回值
+#define PARSE_OK            0
+#define PARSE_ERR_MISSING   1   // 字段缺失或为空
+#define PARSE_ERR_SYNTAX    2   // 非法字符
+#define PARSE_ERR_OVERFLOW  3   // 超出int32范围
+#define PARSE_ERR_EXTRA     4   // 字段数多于预期
+
+uint8 parse_fixed(const char** cursor, int32* value, uint8 decimals);
+uint8 parse_fixed_fields(const char* str, int32* values, uint8 count, uint8 decimals);
+uint8 parse_uint(const char** cursor, uint32* value);
+
+#endif /* PARSE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,100 @@
+/*
+ * profile.c - 命令和处理阶段的耗时统计
+ */
+
+#include <string.h>
+#include "profile.h"
+
+// ============ 模块状态 ============
+static ProfileSlot slots[PROFILE_MAX_SLOTS];
+static uint8 slot_count = 0;
+
+// ============ 内部函数 ============
+static void clear_stats(ProfileSlot* s) {
+    s->count = 0;
+    s->min_ticks = 0xFFFFFFFFu;
+    s->max_ticks = 0;
+    s->total_ticks = 0;
+    memset(s->histogram, 0, sizeof(s->histogram));
+}
+
+// floor(log2(ticks))，Cortex-M0+ 没有CLZ指令，用二分代替
+static uint8 bucket(uint32 ticks) {
+    uint8 b = 0;
+
+    if(ticks >= (1uL << 16)) { ticks >>= 16; b += 16; }
+    if(ticks >= (1uL << 8))  { ticks >>= 8;  b += 8; }
+    if(ticks >= (1uL << 4))  { ticks >>= 4;  b += 4; }
+    if(ticks >= (1uL << 2))  { ticks >>= 2;  b += 2; }
+    if(ticks >= (1uL << 1))  { b += 1; }
+
+    return (b < PROFILE_BUCKETS) ? b : (PROFILE_BUCKETS - 1);
+}
+
+// ============ 对外接口 ============
+void profile_init(void) {
+    slot_count = 0;
+}
+
+// 按名称查找测量点，没有时登记新的；槽满返回 PROFILE_INVALID（之后的记录被忽略）
+uint8 profile_slot(const char* name) {
+    ProfileSlot* s;
+    uint8 i;
+
+    for(i = 0; i < slot_count; i++) {
+        if(strncmp(slots[i].name, name, PROFILE_NAME_LEN - 1) == 0) {
+            return i;
+        }
+    }
+    if(slot_count >= PROFILE_MAX_SLOTS) {
+        return PROFILE_INVALID;
+    }
+
+    s = &slots[slot_count];
+    strncpy(s->name, name, PROFILE_NAME_LEN - 1);
+    s->name[PROFILE_NAME_LEN - 1] = '\0';
+    clear_stats(s);
+    return slot_count++;
+}
+
+void profile_record(uint8 id, uint32 ticks) {
+    ProfileSlot* s;
+    uint16* bin;
+
+    if(id >= slot_count) {
+        return;
+    }
+    s = &slots[id];
+
+    s->count++;
+    s->total_ticks += ticks;
+    if(ticks < s->min_ticks) {
+        s->min_ticks = ticks;
+    }
+    if(ticks > s->max_ticks) {
+        s->max_ticks = ticks;
+    }
+    bin = &s->histogram[bucket(ticks)];
+    if(*bin < 0xFFFFu) {
+        (*bin)++;
+    }
+}
+
+// 清零统计，已登记的名称和编号保持不变
+void profile_reset(void) {
+    uint8 i;
+
+    for(i = 0; i < slot_count; i++) {
+        clear_stats(&slots[i]);
+    }
+}
+
+uint8 profile_count(void) {
+    return slot_count;
+}
+
+const ProfileSlot* profile_get(uint8 id) {
+    return (id < slot_count) ? &slots[id] : NULL;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,44 @@
+/*
+ * profile.h - 命令和处理阶段的耗时统计（PROFILE 命令输出）
+ *
+ * 每个测量点是一个按名称登记的槽，统计次数、最短/最长/平均耗时和log2直方图，
+ * 时间单位为 timebase_ticks() 的计数（有 Timer_1us 时12MHz，即2个CPU周期）：
+ *   start = PROFILE_START();  ...被测代码...  PROFILE_STOP(id, start);
+ * 一个测量点只有两次计数器读取、几次比较和加法，可以常驻编译。
+ * 固定的处理阶段（发送、传感器读取等）和每个命令分支的测量点都在启动时登记，
+ * 运行中按编号记录，不查找名称；槽满后登记的名称不再统计。只在任务（主循环）上下文中调用。
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "project.h"
+#include "timebase.h"
+
+#define PROFILE_MAX_SLOTS       56      // 6个固定阶段 + 47个命令分支和未知命令（main.c 的 PROF_CMD_COUNT）
+#define PROFILE_NAME_LEN        16      // 含结尾'\0'，更长的名称截断
+#define PROFILE_BUCKETS         24      // 第k个：[2^k, 2^(k+1)) 计数，最后一个包含更长的耗时
+#define PROFILE_INVALID         0xFF
+
+typedef struct {
+    char name[PROFILE_NAME_LEN];
+    uint32 count;
+    uint32 min_ticks;
+    uint32 max_ticks;
+    uint64 total_ticks;
+    uint16 histogram[PROFILE_BUCKETS];  // 饱和于0xFFFF
+} ProfileSlot;
+
+#define PROFILE_START()             timebase_ticks()
+#define PROFILE_STOP(id, start)     profile_record((id), timebase_ticks() - (start))
+
+void profile_init(void);
+uint8 profile_slot(const char* name);
+void profile_record(uint8 id, uint32 ticks);
+void profile_reset(void);
+uint8 profile_count(void);
+const ProfileSlot* profile_get(uint8 id);
+
+#endif /* PROFILE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,235 @@
+/*
+ * sched.c - 协作式任务调度（运行到完成，无抢占）
+ */
+
+#include "sched.h"
+#include "timebase.h"
+
+typedef struct {
+    SchedTask run;
+    uint32 period_us;           // 0 = 只由事件或预约唤醒
+    uint32 next_us;             // 下一个周期或预约唤醒时间
+    uint8 timer_armed;
+    SchedStats stats;
+} SchedTaskEntry;
+
+// ============ 模块状态 ============
+static SchedTaskEntry tasks[SCHED_MAX_TASKS];
+static uint8 task_count = 0;
+
+// 中断置位的事件标志和置位时间（用于就绪延迟）
+static volatile uint8 event_flags = 0;
+static volatile uint32 event_us[SCHED_MAX_TASKS];
+
+// 空闲睡眠
+static uint8 idle_sleep_enabled = 1;
+static uint64 idle_sleep_us = 0;
+static uint32 idle_sleeps = 0;
+static uint32 idle_window_start_ms = 0;
+
+// ============ 内部函数 ============
+static void set_period(SchedTaskEntry* t, uint16 period_ms) {
+    t->period_us = (uint32)period_ms * 1000u;
+    t->next_us = timebase_us() + t->period_us;
+    t->timer_armed = (period_ms != 0);
+}
+
+// 就绪时返回1，ready_us 为就绪时间（事件置位时间或到期时间）
+static uint8 task_ready(uint8 id, uint32 now, uint32* ready_us) {
+    SchedTaskEntry* t = &tasks[id];
+    
+    if(event_flags & (1u << id)) {
+        *ready_us = event_us[id];
+        return 1;
+    }
+    if(t->timer_armed && TIMEBASE_EXPIRED(now, t->next_us)) {
+        *ready_us = t->next_us;
+        return 1;
+    }
+    return 0;
+}
+
+// ============ 对外接口 ============
+void sched_init(void) {
+    task_count = 0;
+    event_flags = 0;
+    sched_reset_idle_stats();
+}
+
+// 按优先级从高到低注册；period_ms 为0时只由事件或 sched_wake_after() 触发
+// 返回任务号，任务表满时返回 SCHED_INVALID
+uint8 sched_add(const char* name, SchedTask task, uint16 period_ms) {
+    SchedTaskEntry* t;
+    
+    if(task_count >= SCHED_MAX_TASKS) {
+        return SCHED_INVALID;
+    }
+    t = &tasks[task_count];
+    t->run = task;
+    t->stats.name = name;
+    t->stats.runs = 0;
+    t->stats.total_us = 0;
+    t->stats.max_run_us = 0;
+    t->stats.max_latency_us = 0;
+    set_period(t, period_ms);
+    
+    return task_count++;
+}
+
+void sched_set_period(uint8 task, uint16 period_ms) {
+    if(task < task_count) {
+        set_period(&tasks[task], period_ms);
+    }
+}
+
+// 可在中断中调用；任务运行前多次置位只算一次
+void sched_signal(uint8 task) {
+    uint8 int_state;
+    
+    if(task >= SCHED_MAX_TASKS) {
+        return;
+    }
+    int_state = CyEnterCriticalSection();
+    if(!(event_flags & (1u << task))) {
+        event_us[task] = timebase_us();
+        event_flags |= (uint8)(1u << task);
+    }
+    CyExitCriticalSection(int_state);
+}
+
+// 预约 ms 后再运行一次（周期任务改为在此时间运行，之后恢复周期）
+void sched_wake_after(uint8 task, uint16 ms) {
+    if(task >= task_count) {
+        return;
+    }
+    tasks[task].next_us = timebase_us() + (uint32)ms * 1000u;
+    tasks[task].timer_armed = 1;
+}
+
+// 执行一轮：按优先级运行所有就绪的任务，返回运行的任务数
+uint8 sched_run(void) {
+    SchedTaskEntry* t;
+    uint32 ready_us;
+    uint32 start_us;
+    uint32 elapsed;
+    uint8 int_state;
+    uint8 ran = 0;
+    uint8 id;
+    
+    for(id = 0; id < task_count; id++) {
+        t = &tasks[id];
+        start_us = timebase_us();
+        if(!task_ready(id, start_us, &ready_us)) {
+            continue;
+        }
+        
+        // 先清除事件和定时再运行，任务运行期间的新事件会让它在下一轮再次就绪
+        int_state = CyEnterCriticalSection();
+        event_flags &= (uint8)~(1u << id);
+        CyExitCriticalSection(int_state);
+        if(t->period_us != 0) {
+            // 周期按计划时间累加，落后超过一个周期时从现在重新开始，不连续补跑
+            t->next_us += t->period_us;
+            if(TIMEBASE_EXPIRED(start_us, t->next_us)) {
+                t->next_us = start_us + t->period_us;
+            }
+        } else if(t->timer_armed && TIMEBASE_EXPIRED(start_us, t->next_us)) {
+            // 只有到期的预约才清除；由事件触发时保留尚未到期的预约
+            t->timer_armed = 0;
+        }
+        
+        t->run();
+        
+        elapsed = timebase_us() - start_us;
+        t->stats.runs++;
+        t->stats.total_us += elapsed;
+        if(elapsed > t->stats.max_run_us) {
+            t->stats.max_run_us = elapsed;
+        }
+        if(start_us - ready_us > t->stats.max_latency_us) {
+            t->stats.max_latency_us = start_us - ready_us;
+        }
+        ran++;
+    }
+    
+    return ran;
+}
+
+// 有事件待处理或有定时已到期的任务时返回1
+uint8 sched_pending(void) {
+    uint32 now = timebase_us();
+    uint32 ready_us;
+    uint8 id;
+    
+    for(id = 0; id < task_count; id++) {
+        if(task_ready(id, now, &ready_us)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 主循环在 sched_run() 之后调用：没有就绪任务时睡眠到下一个中断
+void sched_idle(void) {
+    uint8 int_state;
+    uint32 start_us;
+    
+    if(!idle_sleep_enabled) {
+        return;
+    }
+    // 关中断后再检查：检查之后到来的中断挂起，WFI立即返回，返回后中断服务才执行
+    int_state = CyEnterCriticalSection();
+    if(!sched_pending()) {
+        start_us = timebase_us();
+        CySysPmSleep();
+        idle_sleep_us += timebase_us() - start_us;
+        idle_sleeps++;
+    }
+    CyExitCriticalSection(int_state);
+}
+
+void sched_set_idle_sleep(uint8 enable) {
+    idle_sleep_enabled = enable;
+}
+
+uint8 sched_idle_sleep(void) {
+    return idle_sleep_enabled;
+}
+
+void sched_idle_stats(SchedIdleStats* stats) {
+    uint64 permille;
+    
+    stats->window_ms = timebase_ms() - idle_window_start_ms;
+    stats->sleep_ms = (uint32)(idle_sleep_us / 1000u);
+    stats->sleeps = idle_sleeps;
+    // us / ms 即千分比
+    permille = (stats->window_ms > 0) ? idle_sleep_us / stats->window_ms : 0;
+    stats->sleep_permille = (permille > 1000u) ? 1000u : (uint16)permille;
+}
+
+void sched_reset_idle_stats(void) {
+    idle_sleep_us = 0;
+    idle_sleeps = 0;
+    idle_window_start_ms = timebase_ms();
+}
+
+uint8 sched_task_count(void) {
+    return task_count;
+}
+
+const SchedStats* sched_stats(uint8 task) {
+    return (task < task_count) ? &tasks[task].stats : NULL;
+}
+
+void sched_reset_stats(void) {
+    uint8 id;
+    
+    for(id = 0; id < task_count; id++) {
+        tasks[id].stats.runs = 0;
+        tasks[id].stats.total_us = 0;
+        tasks[id].stats.max_run_us = 0;
+        tasks[id].stats.max_latency_us = 0;
+    }
+}
+
+/* [] END OF FILE */
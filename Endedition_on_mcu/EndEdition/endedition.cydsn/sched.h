@@ -0,0 +1,66 @@
+/*
+ * sched.h - 协作式任务调度（运行到完成，无抢占）
+ *
+ * 每个任务是一个短函数，在以下情况就绪：
+ *   1. 中断调用 sched_signal() 置位了事件标志（UART接收、步进完成、I2C完成等）
+ *   2. 周期任务到达下一个周期
+ *   3. 任务自己用 sched_wake_after() 预约的唤醒时间已到
+ * sched_run() 按注册顺序（即优先级）执行所有就绪的任务，每个任务执行完才轮到下一个，
+ * 任务之间不需要加锁；与中断共享的数据仍需临界区。任务不能阻塞等待，
+ * 需要等待的流程拆成状态机，用 sched_wake_after() 或事件回到任务中。
+ *
+ * 每个任务统计运行次数、总运行时间、最长单次运行时间和最坏就绪延迟
+ * （从就绪到开始运行，us），由 TASKS 命令输出。
+ *
+ * 没有就绪任务时 sched_idle() 让CPU进入Sleep（CySysPmSleep），外设和时钟照常运行，
+ * 任何中断（UART接收、SysTick、I2C、GPIO）都会唤醒；至少每1ms有一次SysTick，
+ * 定时任务的到期检查不受影响。检查与进入Sleep之间关中断，
+ * 这期间到来的中断保持挂起并立即唤醒WFI，不会丢失事件。
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "project.h"
+
+#define SCHED_MAX_TASKS         8
+#define SCHED_INVALID           0xFF
+
+typedef void (*SchedTask)(void);
+
+typedef struct {
+    uint32 window_ms;           // 统计时长
+    uint32 sleep_ms;
+    uint16 sleep_permille;      // 睡眠时间占比（0.1%）
+    uint32 sleeps;              // 进入Sleep的次数
+} SchedIdleStats;
+
+typedef struct {
+    const char* name;
+    uint32 runs;
+    uint32 total_us;
+    uint32 max_run_us;
+    uint32 max_latency_us;
+} SchedStats;
+
+void sched_init(void);
+uint8 sched_add(const char* name, SchedTask task, uint16 period_ms);
+void sched_set_period(uint8 task, uint16 period_ms);
+void sched_signal(uint8 task);
+void sched_wake_after(uint8 task, uint16 ms);
+uint8 sched_run(void);
+uint8 sched_pending(void);
+
+void sched_idle(void);
+void sched_set_idle_sleep(uint8 enable);
+uint8 sched_idle_sleep(void);
+void sched_idle_stats(SchedIdleStats* stats);
+void sched_reset_idle_stats(void);
+
+uint8 sched_task_count(void);
+const SchedStats* sched_stats(uint8 task);
+void sched_reset_stats(void);
+
+#endif /* SCHED_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,66 @@
+/*
+ * snapshot.c - 传感器快照（双缓冲）
+ */
+
+#include "snapshot.h"
+#include "timebase.h"
+#include <string.h>
+
+// ============ 模块状态 ============
+static SensorSnapshot buffers[2];
+static volatile uint8 front = 0;        // 单字节写入，翻转是原子的
+static uint8 dirty = 0;
+static uint32 seq = 0;
+
+// ============ 对外接口 ============
+void snapshot_init(void) {
+    memset(buffers, 0, sizeof(buffers));
+    front = 0;
+    dirty = 0;
+    seq = 0;
+}
+
+// 写入后缓冲区；quality 为 FILTER_QUALITY_NONE 时字段无效，value 不更新
+void snapshot_update(uint8 field, int32 value, uint8 quality, uint32 acquired_us) {
+    SensorSnapshot* back = &buffers[front ^ 1u];
+    
+    if(field >= SNAPSHOT_FIELDS) {
+        return;
+    }
+    if(quality != 0) {
+        back->value[field] = value;
+    }
+    back->quality[field] = quality;
+    back->updated_ms[field] = timebase_ms();
+    back->acquired_us[field] = acquired_us;
+    back->written |= (uint16)(1u << field);
+    dirty = 1;
+}
+
+// 有字段更新时翻转前后缓冲区，新的后缓冲区从前缓冲区复制，未更新的字段保持不变
+uint8 snapshot_publish(void) {
+    uint8 back = front ^ 1u;
+    
+    if(!dirty) {
+        return 0;
+    }
+    buffers[back].seq = ++seq;
+    buffers[back].time_ms = timebase_ms();
+    front = back;
+    buffers[back ^ 1u] = buffers[back];
+    dirty = 0;
+    return 1;
+}
+
+const SensorSnapshot* snapshot_front(void) {
+    return &buffers[front];
+}
+
+uint32 snapshot_age_ms(const SensorSnapshot* snapshot, uint8 field) {
+    if(field >= SNAPSHOT_FIELDS || !(snapshot->written & (1u << field))) {
+        return SNAPSHOT_NEVER;
+    }
+    return timebase_ms() - snapshot->updated_ms[field];
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,43 @@
+/*
+ * snapshot.h - 传感器快照（双缓冲）
+ *
+ * 后台采集（sensors_poll）把各传感器的新值写入后缓冲区，
+ * 一轮采集结束时 snapshot_publish() 翻转前后缓冲区，读取方（GET_SENSORS）
+ * 只格式化前缓冲区，不做任何传感器I/O，耗时与传感器速度无关。
+ * 每次发布带递增的序号，每个字段记录最后更新时间（计算数据的年龄）
+ * 和样本的采集时间（timebase_us，与 TIME_SYNC 同一时钟）。
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "project.h"
+
+// 字段（前6个与滤波通道一一对应）
+#define SNAPSHOT_DIST0          0       // 四路距离，0.1mm
+#define SNAPSHOT_TEMP           4       // 腔体温度，0.01°C
+#define SNAPSHOT_CAP            5       // 电容，fF
+#define SNAPSHOT_LUX0           6       // 四路环境光，0.1lux
+#define SNAPSHOT_FIELDS         10
+
+#define SNAPSHOT_NEVER          0xFFFFFFFFu     // 字段从未更新过时的年龄
+
+typedef struct {
+    uint32 seq;                             // 发布序号，0 = 尚未发布
+    uint32 time_ms;                         // 发布时间
+    int32 value[SNAPSHOT_FIELDS];
+    uint32 updated_ms[SNAPSHOT_FIELDS];
+    uint32 acquired_us[SNAPSHOT_FIELDS];    // 样本采集时间
+    uint8 quality[SNAPSHOT_FIELDS];         // FILTER_QUALITY_*，NONE = 无效
+    uint16 written;                         // 更新过的字段（bit n = 字段n）
+} SensorSnapshot;
+
+void snapshot_init(void);
+void snapshot_update(uint8 field, int32 value, uint8 quality, uint32 acquired_us);
+uint8 snapshot_publish(void);
+const SensorSnapshot* snapshot_front(void);
+uint32 snapshot_age_ms(const SensorSnapshot* snapshot, uint8 field);
+
+#endif /* SNAPSHOT_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,103 @@
+/*
+ * stepper.c - 步进脉冲发生（SysTick中断驱动，不阻塞主循环）
+ */
+
+#include "stepper.h"
+
+#define STEPPER_SYSTICK_SLOT    2u
+
+// ============ 模块状态（中断与主循环共享） ============
+static void (*notify_fn)(void) = NULL;
+static volatile uint8 state = STEPPER_IDLE;
+static volatile uint8 stop_request = 0;
+static volatile int32 steps_done = 0;
+static int32 steps_total = 0;           // 绝对值
+static int8 step_sign = 1;
+static uint8 half_period = 1;
+static uint8 limit_level = STEPPER_LIMIT_IGNORE;
+static uint8 tick_count = 0;
+static uint8 pin_high = 0;
+
+// ============ 内部函数 ============
+static void finish(uint8 result) {
+    state = result;
+    if(notify_fn != NULL) {
+        notify_fn();
+    }
+}
+
+// ============ SysTick回调（中断上下文） ============
+static void stepper_tick(void) {
+    if(state != STEPPER_RUNNING || ++tick_count < half_period) {
+        return;
+    }
+    tick_count = 0;
+    
+    if(pin_high) {
+        Pin_STEP_Write(0);
+        pin_high = 0;
+        steps_done += step_sign;
+        return;
+    }
+    
+    // 每步开始前检查结束条件
+    if(stop_request) {
+        finish(STEPPER_STOPPED);
+    } else if(limit_level != STEPPER_LIMIT_IGNORE && Pin_LimitSwitch_Read() == limit_level) {
+        finish(STEPPER_LIMIT);
+    } else if(steps_done * step_sign >= steps_total) {
+        finish(STEPPER_DONE);
+    } else {
+        Pin_STEP_Write(1);
+        pin_high = 1;
+    }
+}
+
+// ============ 对外接口 ============
+// notify 在每次运动结束时于中断中调用
+void stepper_init(void (*notify)(void)) {
+    notify_fn = notify;
+    state = STEPPER_IDLE;
+    Pin_STEP_Write(0);
+    
+    CySysTickStart();
+    CySysTickSetCallback(STEPPER_SYSTICK_SLOT, stepper_tick);
+}
+
+// 正步数方向脚为0（高度增加），负步数为1；第一个脉冲在 half_period_ms 后开始，
+// 期间作为方向建立时间。stop_level 为限位开关停止电平或 STEPPER_LIMIT_IGNORE
+uint8 stepper_start(int32 steps, uint8 half_period_ms, uint8 stop_level) {
+    if(state == STEPPER_RUNNING || half_period_ms == 0) {
+        return 0;
+    }
+    Pin_DIR_Write((steps > 0) ? 0 : 1);
+    
+    steps_total = (steps > 0) ? steps : -steps;
+    step_sign = (steps > 0) ? 1 : -1;
+    half_period = half_period_ms;
+    limit_level = stop_level;
+    steps_done = 0;
+    tick_count = 0;
+    pin_high = 0;
+    stop_request = 0;
+    state = STEPPER_RUNNING;
+    return 1;
+}
+
+// 在当前步完成后停止（最多 half_period_ms 后通知）
+void stepper_stop(void) {
+    if(state == STEPPER_RUNNING) {
+        stop_request = 1;
+    }
+}
+
+uint8 stepper_state(void) {
+    return state;
+}
+
+// 本次运动已完成的步数（带方向）
+int32 stepper_steps_done(void) {
+    return steps_done;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,32 @@
+/*
+ * stepper.h - 步进脉冲发生（SysTick中断驱动，不阻塞主循环）
+ *
+ * SysTick每1ms回调一次，每 half_period_ms 翻转一次 Pin_STEP，
+ * 一个高电平 + 一个低电平为一步。每步开始前检查停止请求和限位开关，
+ * 走完、被停止或限位开关到达指定电平时停止并通过 notify 回调通知（中断上下文）。
+ * Pin_ENABLE 由调用者控制。
+ */
+
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include "project.h"
+
+#define STEPPER_LIMIT_IGNORE        0xFF    // 不检查限位开关
+
+// 状态
+#define STEPPER_IDLE                0
+#define STEPPER_RUNNING             1
+#define STEPPER_DONE                2       // 走完指定步数
+#define STEPPER_STOPPED             3       // stepper_stop()
+#define STEPPER_LIMIT               4       // 限位开关到达指定电平
+
+void stepper_init(void (*notify)(void));
+uint8 stepper_start(int32 steps, uint8 half_period_ms, uint8 stop_level);
+void stepper_stop(void);
+uint8 stepper_state(void);
+int32 stepper_steps_done(void);
+
+#endif /* STEPPER_H */
+
+/* [] END OF FILE */
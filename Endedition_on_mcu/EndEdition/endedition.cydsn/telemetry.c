@@ -0,0 +1,225 @@
+/*
+ * telemetry.c - 周期性遥测数据推送（STREAM命令）
+ *
+ * SysTick每1ms回调一次，到达采样周期时置位标志；
+ * 主循环中的 telemetry_poll() 把数值写入预先格式化好的输出缓冲区并发送。
+ * 字段列表只在 STREAM 命令时解析一次，采样时不做任何解析或动态分配。
+ */
+
+#include "telemetry.h"
+#include "cdc_system.h"
+#include "fmt.h"
+#include "timebase.h"
+#include <string.h>
+
+#define TELEMETRY_SYSTICK_SLOT  0u
+#define TELEMETRY_PREFIX        "DATA:"
+
+typedef enum {
+    FIELD_STATUS,
+    FIELD_HEIGHT,
+    FIELD_ANGLE,
+    FIELD_DISTANCES,
+    FIELD_TEMPERATURE,
+    FIELD_CAPACITANCE,
+    FIELD_LIGHT,
+    FIELD_TIME
+} TelemetryField;
+
+// ============ 模块状态 ============
+static volatile uint8 stream_active = 0;
+static volatile uint8 sample_pending = 0;
+static volatile uint16 tick_count = 0;
+static uint16 period_ms = 0;
+static uint32 sample_seq = 0;
+static void (*notify_fn)(void) = NULL;
+
+static uint8 field_list[TELEMETRY_MAX_FIELDS];
+static uint8 field_count = 0;
+
+// 复用的输出缓冲区，前缀在启动时写入一次
+static char out_buffer[TELEMETRY_BUFFER_SIZE];
+static uint8 prefix_len = 0;
+
+// ============ SysTick回调（中断上下文） ============
+static void telemetry_tick(void) {
+    if(!stream_active) {
+        return;
+    }
+    if(++tick_count >= period_ms) {
+        tick_count = 0;
+        sample_pending = 1;
+        if(notify_fn != NULL) {
+            notify_fn();
+        }
+    }
+}
+
+// ============ 内部函数 ============
+static uint8 parse_field(char code, uint8* field) {
+    switch(code) {
+        case 'S': *field = FIELD_STATUS;      return 1;
+        case 'H': *field = FIELD_HEIGHT;      return 1;
+        case 'A': *field = FIELD_ANGLE;       return 1;
+        case 'D': *field = FIELD_DISTANCES;   return 1;
+        case 'T': *field = FIELD_TEMPERATURE; return 1;
+        case 'C': *field = FIELD_CAPACITANCE; return 1;
+        case 'L': *field = FIELD_LIGHT;       return 1;
+        case 'U': *field = FIELD_TIME;        return 1;
+        default:  return 0;
+    }
+}
+
+// 无有效样本的距离通道输出NA
+static uint16 fmt_distance(char* p, float value, uint8 channel) {
+    if(distance_valid & (1u << channel)) {
+        return fmt_float(p, value, 1);
+    }
+    return fmt_str(p, "NA");
+}
+
+static uint16 fmt_lux(char* p, uint8 channel) {
+    if(ambient_lux_valid & (1u << channel)) {
+        return fmt_fixed(p, (int32)ambient_lux_x10[channel], 1);
+    }
+    return fmt_str(p, "NA");
+}
+
+// ============ 对外接口 ============
+void telemetry_init(void) {
+    stream_active = 0;
+    sample_pending = 0;
+
+    memcpy(out_buffer, TELEMETRY_PREFIX, sizeof(TELEMETRY_PREFIX) - 1);
+    prefix_len = sizeof(TELEMETRY_PREFIX) - 1;
+
+    CySysTickStart();
+    CySysTickSetCallback(TELEMETRY_SYSTICK_SLOT, telemetry_tick);
+}
+
+// 到达采样时间时调用 notify（中断上下文）
+void telemetry_set_notify(void (*notify)(void)) {
+    notify_fn = notify;
+}
+
+uint8 telemetry_start(uint16 rate_hz, const char* fields) {
+    uint8 parsed[TELEMETRY_MAX_FIELDS];
+    uint8 count = 0;
+    uint8 seen = 0;
+
+    if(rate_hz < TELEMETRY_MIN_RATE_HZ || rate_hz > TELEMETRY_MAX_RATE_HZ) {
+        return TELEMETRY_ERR_RATE;
+    }
+
+    if(fields == NULL || *fields == '\0') {
+        fields = TELEMETRY_FIELDS_DEFAULT;
+    }
+
+    while(*fields) {
+        uint8 field_mask_bit;
+
+        if(count >= TELEMETRY_MAX_FIELDS || !parse_field(*fields, &parsed[count])) {
+            return TELEMETRY_ERR_FIELD;
+        }
+        // 每个字段只允许出现一次，保证输出不超出缓冲区
+        field_mask_bit = (uint8)(1u << parsed[count]);
+        if(seen & field_mask_bit) {
+            return TELEMETRY_ERR_FIELD;
+        }
+        seen |= field_mask_bit;
+        count++;
+        fields++;
+    }
+
+    // 停止后再更新配置，避免ISR看到半更新的状态
+    stream_active = 0;
+    memcpy(field_list, parsed, count);
+    field_count = count;
+    period_ms = 1000 / rate_hz;
+    sample_seq = 0;
+    tick_count = 0;
+    sample_pending = 0;
+    stream_active = 1;
+
+    return TELEMETRY_OK;
+}
+
+void telemetry_stop(void) {
+    stream_active = 0;
+    sample_pending = 0;
+}
+
+uint8 telemetry_is_active(void) {
+    return stream_active;
+}
+
+void telemetry_poll(void) {
+    char* p;
+    uint8 i;
+
+    if(!sample_pending) {
+        return;
+    }
+    sample_pending = 0;
+
+    p = out_buffer + prefix_len;
+    p += fmt_uint(p, sample_seq++);
+
+    for(i = 0; i < field_count; i++) {
+        *p++ = ',';
+        switch(field_list[i]) {
+            case FIELD_STATUS:
+                p += fmt_str(p, system_status_string());
+                break;
+            case FIELD_HEIGHT:
+                p += fmt_float(p, current_height, 1);
+                break;
+            case FIELD_ANGLE:
+                p += fmt_float(p, current_angle, 1);
+                break;
+            case FIELD_DISTANCES:
+                p += fmt_distance(p, distance_upper1, 0);
+                *p++ = ',';
+                p += fmt_distance(p, distance_upper2, 1);
+                *p++ = ',';
+                p += fmt_distance(p, distance_lower1, 2);
+                *p++ = ',';
+                p += fmt_distance(p, distance_lower2, 3);
+                break;
+            case FIELD_TEMPERATURE:
+                if(temperature_valid) {
+                    p += fmt_float(p, temperature, 1);
+                } else {
+                    p += fmt_str(p, "NA");
+                }
+                break;
+            case FIELD_CAPACITANCE:
+                if(capacitance_valid) {
+                    p += fmt_float(p, capacitance, 3);
+                } else {
+                    p += fmt_str(p, "NA");
+                }
+                break;
+            case FIELD_LIGHT:
+                p += fmt_lux(p, 0);
+                *p++ = ',';
+                p += fmt_lux(p, 1);
+                *p++ = ',';
+                p += fmt_lux(p, 2);
+                *p++ = ',';
+                p += fmt_lux(p, 3);
+                break;
+            case FIELD_TIME:
+                p += fmt_uint(p, timebase_us());
+                break;
+            default:
+                break;
+        }
+    }
+
+    fmt_str(p, "\r\n");
+
+    uart_send_response(out_buffer);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,36 @@
+/*
+ * telemetry.h - 周期性遥测数据推送（STREAM命令）
+ * 由SysTick定时触发，按配置的速率推送状态和传感器字段
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "project.h"
+
+#define TELEMETRY_MIN_RATE_HZ   1
+#define TELEMETRY_MAX_RATE_HZ   100
+#define TELEMETRY_MAX_FIELDS    8
+#define TELEMETRY_BUFFER_SIZE   192
+
+// 字段代码（STREAM:rate,fields 中的字母）
+#define TELEMETRY_FIELDS_DEFAULT "SHA"
+// S - 系统状态      H - 当前高度    A - 当前角度
+// D - 四路距离      T - 温度        C - 电容
+// L - 四路环境光（lux）  U - 本行采样时间（us，timebase_us）
+
+// 返回值
+#define TELEMETRY_OK            0
+#define TELEMETRY_ERR_RATE      1
+#define TELEMETRY_ERR_FIELD     2
+
+void telemetry_init(void);
+void telemetry_set_notify(void (*notify)(void));
+uint8 telemetry_start(uint16 rate_hz, const char* fields);
+void telemetry_stop(void);
+uint8 telemetry_is_active(void);
+void telemetry_poll(void);
+
+#endif /* TELEMETRY_H */
+
+/* [] END OF FILE */
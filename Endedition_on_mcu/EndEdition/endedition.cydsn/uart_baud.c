@@ -0,0 +1,162 @@
+/*
+ * uart_baud.c - UART波特率运行时切换（SET_BAUD命令）
+ *
+ * 流程：
+ *   1. uart_baud_prepare() 计算分频值和过采样倍数（旧速率下回复OK）
+ *   2. uart_baud_switch()  等待发送完成后重新配置SCB并开始计时
+ *   3. PC以新速率发送 BAUD_OK，uart_baud_confirm() 确认
+ *   4. 超时未确认时 uart_baud_poll() 恢复上电默认速率
+ */
+
+#include "uart_baud.h"
+
+#define UART_BAUD_SYSTICK_SLOT  1u
+#define UART_BAUD_CLOCK_HZ      CYDEV_BCLK__HFCLK__HZ
+
+typedef struct {
+    uint16 divider;     // SCB时钟分频值（实际值，非寄存器值）
+    uint8 oversample;   // 过采样倍数
+    uint32 baud;        // 实际波特率
+} BaudConfig;
+
+static BaudConfig default_config;
+static BaudConfig active_config;
+static BaudConfig pending_config;
+
+static uint8 config_prepared = 0;
+static volatile uint8 confirm_pending = 0;
+static volatile uint16 confirm_timer_ms = 0;
+
+// ============ SysTick回调（中断上下文） ============
+static void uart_baud_tick(void) {
+    if(confirm_pending && confirm_timer_ms > 0) {
+        confirm_timer_ms--;
+    }
+}
+
+// ============ 内部函数 ============
+static uint8 compute_config(uint32 baud, BaudConfig* config) {
+    uint32 best_error = 0xFFFFFFFFu;
+    uint32 ovs;
+
+    // 从高过采样开始搜索，误差相同时优先抗噪声能力更好的配置
+    for(ovs = UART_BAUD_OVS_MAX; ovs >= UART_BAUD_OVS_MIN; ovs--) {
+        uint32 divider = (UART_BAUD_CLOCK_HZ + (ovs * baud) / 2) / (ovs * baud);
+        uint32 actual;
+        uint32 error;
+
+        if(divider == 0 || divider > 0xFFFFu) {
+            continue;
+        }
+
+        actual = UART_BAUD_CLOCK_HZ / (divider * ovs);
+        error = (actual > baud) ? (actual - baud) : (baud - actual);
+        error = (error * 1000u) / baud;
+
+        if(error < best_error) {
+            best_error = error;
+            config->divider = (uint16)divider;
+            config->oversample = (uint8)ovs;
+            config->baud = actual;
+        }
+    }
+
+    return (best_error <= UART_BAUD_MAX_ERROR_PERMILLE) ? 1 : 0;
+}
+
+static void apply_config(const BaudConfig* config) {
+    // 等待软件缓冲区、FIFO和移位寄存器全部发送完毕
+    while(UART_SpiUartGetTxBufferSize() != 0u) {
+    }
+    while(UART_GET_TX_FIFO_SR_VALID) {
+    }
+
+    UART_Stop();
+
+    UART_SCBCLK_SetFractionalDividerRegister((uint16)(config->divider - 1u), 0u);
+    UART_CTRL_REG = (UART_CTRL_REG & (uint32)~UART_CTRL_OVS_MASK) |
+                    UART_GET_CTRL_OVS(config->oversample);
+
+    UART_SpiUartClearRxBuffer();
+    UART_SpiUartClearTxBuffer();
+
+    UART_Enable();
+
+    active_config = *config;
+}
+
+// ============ 对外接口 ============
+void uart_baud_init(void) {
+    default_config.divider = (uint16)(UART_SCBCLK_GetDividerRegister() + 1u);
+    default_config.oversample = UART_UART_OVS_FACTOR;
+    default_config.baud = UART_BAUD_CLOCK_HZ /
+                          ((uint32)default_config.divider * default_config.oversample);
+    active_config = default_config;
+
+    CySysTickStart();
+    CySysTickSetCallback(UART_BAUD_SYSTICK_SLOT, uart_baud_tick);
+}
+
+uint8 uart_baud_prepare(uint32 baud) {
+    config_prepared = 0;
+
+    if(confirm_pending) {
+        return UART_BAUD_ERR_BUSY;
+    }
+    if(baud < UART_BAUD_MIN || baud > UART_BAUD_MAX) {
+        return UART_BAUD_ERR_RANGE;
+    }
+    if(!compute_config(baud, &pending_config)) {
+        return UART_BAUD_ERR_ACCURACY;
+    }
+
+    config_prepared = 1;
+    return UART_BAUD_OK;
+}
+
+void uart_baud_switch(void) {
+    if(!config_prepared) {
+        return;
+    }
+    config_prepared = 0;
+
+    apply_config(&pending_config);
+
+    // 切换回默认速率无需确认
+    if(pending_config.divider == default_config.divider &&
+       pending_config.oversample == default_config.oversample) {
+        return;
+    }
+
+    confirm_timer_ms = UART_BAUD_CONFIRM_TIMEOUT_MS;
+    confirm_pending = 1;
+}
+
+uint8 uart_baud_confirm(void) {
+    if(!confirm_pending) {
+        return 0;
+    }
+    confirm_pending = 0;
+    return 1;
+}
+
+uint8 uart_baud_poll(void) {
+    if(!confirm_pending || confirm_timer_ms > 0) {
+        return 0;
+    }
+
+    // PC未确认，恢复默认速率
+    confirm_pending = 0;
+    apply_config(&default_config);
+    return 1;
+}
+
+uint32 uart_baud_current(void) {
+    return active_config.baud;
+}
+
+uint32 uart_baud_default(void) {
+    return default_config.baud;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,34 @@
+/*
+ * uart_baud.h - UART波特率运行时切换（SET_BAUD命令）
+ * 重新配置SCB时钟分频和过采样，PC未在超时内确认则自动恢复默认速率
+ */
+
+#ifndef UART_BAUD_H
+#define UART_BAUD_H
+
+#include "project.h"
+
+#define UART_BAUD_MIN                   9600u
+#define UART_BAUD_MAX                   3000000u
+#define UART_BAUD_OVS_MIN               8u
+#define UART_BAUD_OVS_MAX               16u
+#define UART_BAUD_MAX_ERROR_PERMILLE    20u     // 允许的最大速率误差 2%
+#define UART_BAUD_CONFIRM_TIMEOUT_MS    2000u   // 等待PC确认的时间
+
+// 返回值
+#define UART_BAUD_OK                    0
+#define UART_BAUD_ERR_RANGE             1
+#define UART_BAUD_ERR_ACCURACY          2
+#define UART_BAUD_ERR_BUSY              3
+
+void uart_baud_init(void);
+uint8 uart_baud_prepare(uint32 baud);
+void uart_baud_switch(void);
+uint8 uart_baud_confirm(void);
+uint8 uart_baud_poll(void);
+uint32 uart_baud_current(void);
+uint32 uart_baud_default(void);
+
+#endif /* UART_BAUD_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,22 @@
+/*
+ * project.h - PC编译用：代替PSoC Creator生成的 project.h，只提供 cytypes.h 中的整数类型
+ */
+
+#ifndef PROJECT_H
+#define PROJECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t     uint8;
+typedef uint16_t    uint16;
+typedef uint32_t    uint32;
+typedef int8_t      int8;
+typedef int16_t     int16;
+typedef int32_t     int32;
+typedef int64_t     int64;
+typedef uint64_t    uint64;
+
+#endif /* PROJECT_H */
+
+/* [] END OF FILE */
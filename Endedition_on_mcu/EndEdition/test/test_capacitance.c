@@ -0,0 +1,258 @@
+/*
+ * test_capacitance.c - capacitance.c 的PC测试：模拟计数源验证换算、两点校准、漂移拟合和超时退避
+ */
+
+#include <stdio.h>
+#include "capacitance.h"
+
+#define STUB_FF_PER_KILOTICK    5000    // 每1000计数 5pF
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while(0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long a_ = (long)(actual); \
+    long e_ = (long)(expected); \
+    if(a_ != e_) { \
+        printf("FAIL %s:%d: %s = %ld, expected %ld\n", __FILE__, __LINE__, #actual, a_, e_); \
+        failures++; \
+    } \
+} while(0)
+
+// ============ 模拟计数源 ============
+static uint16 stub_ticks = 1000;
+static uint8 stub_timeout = 0;          // 1 = 每次计时都超时
+static uint32 stub_calls = 0;
+
+static uint8 stub_measure(uint16* ticks) {
+    stub_calls++;
+    if(stub_timeout) {
+        return CAP_ERR_TIMEOUT;
+    }
+    *ticks = stub_ticks;
+    return CAP_OK;
+}
+
+static const CapSource stub_source = {
+    stub_measure,
+    STUB_FF_PER_KILOTICK
+};
+
+static uint32 now_ms = 0;
+static int failures = 0;
+
+// 按测量间隔推进时间，直到产生一个平均值（或一次整组超时）
+static void run_average(void) {
+    uint16 i;
+
+    for(i = 0; i < 4 * CAP_AVERAGE_COUNT; i++) {
+        uint8 done = capacitance_poll(now_ms);
+        now_ms += capacitance_interval();
+        if(done) {
+            return;
+        }
+    }
+    printf("FAIL: no average after %u polls\n", (unsigned)i);
+    failures++;
+}
+
+static void reset(void) {
+    static const CapCalibration defaults = { 0, 0, 0, 2500, 0 };
+
+    capacitance_set_calibration(&defaults);
+    capacitance_set_temperature(0, 0);
+    stub_ticks = 1000;
+    stub_timeout = 0;
+    capacitance_init(&stub_source, now_ms);
+}
+
+// ============ 测试 ============
+// 没有校准：测量源的理论比例，零点为0
+static void test_theoretical_ratio(void) {
+    reset();
+    stub_ticks = 1000;
+    run_average();
+    CHECK(capacitance_has_reading());
+    CHECK_EQ(capacitance_stats()->last_ticks_x16, 16000);
+    CHECK_EQ(capacitance_ff(), 5000);
+}
+
+// 零点校准后扣除寄生电容
+static void test_zero_calibration(void) {
+    reset();
+    capacitance_set_temperature(2500, 1);
+    stub_ticks = 1000;
+    CHECK_EQ(capacitance_calibrate(CAP_CAL_ZERO, 0), CAP_OK);
+    CHECK_EQ(capacitance_calibration_status(), CAP_CAL_RUNNING);
+    run_average();
+    CHECK_EQ(capacitance_calibration_status(), CAP_CAL_DONE);
+    CHECK_EQ(capacitance_calibration()->zero_ticks_x16, 16000);
+    CHECK_EQ(capacitance_calibration()->baseline_temp_x100, 2500);
+    CHECK_EQ(capacitance_ff(), 0);
+
+    stub_ticks = 1400;
+    run_average();
+    CHECK_EQ(capacitance_ff(), 2000);
+}
+
+// 两点校准：参考电容定比例，不再使用理论比例
+static void test_reference_calibration(void) {
+    reset();
+    capacitance_set_temperature(2500, 1);
+    stub_ticks = 1000;
+    capacitance_calibrate(CAP_CAL_ZERO, 0);
+    run_average();
+
+    stub_ticks = 3000;
+    CHECK_EQ(capacitance_calibrate(CAP_CAL_REF, 10000), CAP_OK);
+    run_average();
+    CHECK_EQ(capacitance_calibration_status(), CAP_CAL_DONE);
+    CHECK_EQ(capacitance_calibration()->ref_ticks_x16, 48000);
+    CHECK_EQ(capacitance_calibration()->ref_ff, 10000);
+    CHECK_EQ(capacitance_ff(), 10000);
+
+    stub_ticks = 2000;
+    run_average();
+    CHECK_EQ(capacitance_ff(), 5000);
+
+    // 参考计时不大于零点：失败，原校准不变
+    stub_ticks = 900;
+    capacitance_calibrate(CAP_CAL_REF, 10000);
+    run_average();
+    CHECK_EQ(capacitance_calibration_status(), CAP_CAL_FAILED);
+    CHECK_EQ(capacitance_calibration()->ref_ticks_x16, 48000);
+
+    CHECK_EQ(capacitance_calibrate(CAP_CAL_REF, 0), CAP_ERR_RANGE);
+}
+
+// 漂移学习：每个温度读数取一个样本，最小二乘斜率作为 fF/°C，之后按零点温度补偿
+static void test_baseline_fit(void) {
+    uint8 k;
+
+    reset();
+    capacitance_set_temperature(2500, 1);
+    stub_ticks = 1000;
+    capacitance_calibrate(CAP_CAL_ZERO, 0);
+    run_average();
+    stub_ticks = 3000;
+    capacitance_calibrate(CAP_CAL_REF, 10000);
+    run_average();
+
+    // 样本不足
+    CHECK_EQ(capacitance_baseline_start(), CAP_OK);
+    CHECK(capacitance_baseline_active());
+    CHECK_EQ(capacitance_baseline_finish(), CAP_ERR_SPAN);
+    CHECK_EQ(capacitance_baseline_finish(), CAP_ERR_STATE);
+
+    // 20.00..29.00°C，每°C漂移30fF：电容 = 2000 + 30 x (T - 20)，计时 = 1000 + 电容 / 5
+    capacitance_baseline_start();
+    for(k = 0; k < 10; k++) {
+        capacitance_set_temperature(2000 + 100 * k, 1);
+        stub_ticks = (uint16)(1400 + 6 * k);
+        run_average();
+        // 同一个温度读数的后续平均值不计入拟合
+        run_average();
+    }
+    CHECK_EQ(capacitance_baseline_finish(), CAP_OK);
+    CHECK(!capacitance_baseline_active());
+    CHECK_EQ(capacitance_calibration()->tempco_ff, 30);
+
+    // 35°C下未补偿 2000fF，相对零点温度25°C高10°C，扣除300fF
+    capacitance_set_temperature(3500, 1);
+    stub_ticks = 1400;
+    run_average();
+    CHECK_EQ(capacitance_ff(), 1700);
+
+    // 温度无效时不补偿
+    capacitance_set_temperature(3500, 0);
+    run_average();
+    CHECK_EQ(capacitance_ff(), 2000);
+}
+
+// 开路：每组只做一次超时的测量，间隔加倍到上限；恢复后回到设定间隔
+static void test_timeout_backoff(void) {
+    uint32 last_ms;
+    uint32 gap_ms;
+    uint32 expected_ms = 2u * CAP_SAMPLE_INTERVAL_MS;
+    uint8 groups = 0;
+
+    reset();
+    capacitance_set_interval(CAP_SAMPLE_INTERVAL_MS);
+    run_average();
+    CHECK(capacitance_has_reading());
+
+    stub_timeout = 1;
+    capacitance_calibrate(CAP_CAL_ZERO, 0);
+    stub_calls = 0;
+    while(capacitance_poll(now_ms) == 0) {
+        now_ms++;
+    }
+    CHECK_EQ(stub_calls, 1);
+    CHECK_EQ(capacitance_stats()->timeouts, 1);
+    CHECK(!capacitance_has_reading());
+    CHECK_EQ(capacitance_calibration_status(), CAP_CAL_FAILED);
+
+    // 1ms 查询一次，记录每组测量之间的间隔
+    last_ms = now_ms;
+    while(groups < 10) {
+        now_ms++;
+        if(!capacitance_poll(now_ms)) {
+            continue;
+        }
+        gap_ms = now_ms - last_ms;
+        last_ms = now_ms;
+        groups++;
+        CHECK_EQ(gap_ms, expected_ms);
+        expected_ms *= 2u;
+        if(expected_ms > CAP_TIMEOUT_BACKOFF_MAX_MS) {
+            expected_ms = CAP_TIMEOUT_BACKOFF_MAX_MS;
+        }
+    }
+    CHECK_EQ(stub_calls, 11);
+
+    // 恢复：下一组成功后按设定间隔测量
+    stub_timeout = 0;
+    stub_calls = 0;
+    while(stub_calls == 0) {
+        now_ms++;
+        capacitance_poll(now_ms);
+    }
+    CHECK_EQ(stub_calls, CAP_BURST_COUNT);
+    last_ms = now_ms;
+    while(stub_calls == CAP_BURST_COUNT) {
+        now_ms++;
+        capacitance_poll(now_ms);
+    }
+    CHECK_EQ(now_ms - last_ms, CAP_SAMPLE_INTERVAL_MS);
+}
+
+// 没有测量源：不测量，校准和学习都报告没有测量源
+static void test_no_source(void) {
+    capacitance_init(NULL, now_ms);
+    CHECK(!capacitance_available());
+    CHECK_EQ(capacitance_poll(now_ms), 0);
+    CHECK_EQ(capacitance_calibrate(CAP_CAL_ZERO, 0), CAP_ERR_NO_SOURCE);
+    CHECK_EQ(capacitance_baseline_start(), CAP_ERR_NO_SOURCE);
+}
+
+int main(void) {
+    test_theoretical_ratio();
+    test_zero_calibration();
+    test_reference_calibration();
+    test_baseline_fit();
+    test_timeout_backoff();
+    test_no_source();
+
+    if(failures) {
+        printf("test_capacitance: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_capacitance: OK\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,314 @@
+/*
+ * i2c_bus.c - I2C_Distance总线：快速模式、异步事务队列、寄存器突发读写
+ *
+ * 事务槽组成环形队列，三个下标依次推进：
+ *   callback_index <= active_index <= submit_index
+ * [callback_index, active_index) 已完成、等待主循环执行回调；
+ * active_index 为正在传输的事务；其后为排队中的事务。
+ * 回调执行后槽位才释放，回调中拿到的 rx 指针在回调返回前一直有效。
+ *
+ * 阻塞式接口只等待自己的槽完成，其槽不带回调，完成后直接从槽中取结果，
+ * 不调用 i2c_bus_poll()：等待期间不会执行其他事务（异步驱动）的回调，
+ * 这些回调仍在主循环下一次 i2c_bus_poll() 中按顺序执行。
+ */
+
+#include "i2c_bus.h"
+#include "timebase.h"
+#include <string.h>
+
+// 400kHz：HFCLK 24MHz / 3 = 8MHz，8MHz / (13 + 7) = 400kHz
+#define I2C_BUS_SCBCLK_DIVIDER  3u
+#define I2C_BUS_OVS_LOW         13u
+#define I2C_BUS_OVS_HIGH        7u
+
+#define QUEUE_NEXT(i)           ((uint8)(((i) + 1u) % I2C_BUS_QUEUE_SIZE))
+
+typedef enum {
+    PHASE_IDLE,
+    PHASE_WRITE,
+    PHASE_READ
+} I2cBusPhase;
+
+typedef struct {
+    uint8 addr;
+    uint8 tx_len;
+    uint8 rx_len;
+    uint8 result;
+    I2cBusCallback callback;
+    void* context;
+    uint8 tx[I2C_BUS_MAX_TX];
+    uint8 rx[I2C_BUS_MAX_RX];
+} I2cBusTxn;
+
+// ============ 队列状态（中断与主循环共享） ============
+static I2cBusTxn queue[I2C_BUS_QUEUE_SIZE];
+static volatile uint8 submit_index = 0;
+static volatile uint8 active_index = 0;
+static volatile uint8 callback_index = 0;
+static volatile I2cBusPhase phase = PHASE_IDLE;
+static volatile uint32 active_start_ms = 0;
+
+static volatile uint32 error_count = 0;
+static volatile uint32 nak_count = 0;
+static void (*notify_fn)(void) = NULL;
+
+// ============ 总线配置 ============
+// 在原理图配置的基础上只改时钟分频和过采样，滤波设置100k/400k相同
+static void apply_fast_mode(void) {
+    I2C_Distance_Stop();
+    
+    I2C_Distance_SCBCLK_SetFractionalDividerRegister(I2C_BUS_SCBCLK_DIVIDER - 1u, 0u);
+    I2C_Distance_I2C_CTRL_REG = (I2C_Distance_I2C_CTRL_REG &
+                                 ~(I2C_Distance_I2C_CTRL_HIGH_PHASE_OVS_MASK | I2C_Distance_I2C_CTRL_LOW_PHASE_OVS_MASK)) |
+                                I2C_Distance_GET_I2C_CTRL_HIGH_PHASE_OVS(I2C_BUS_OVS_HIGH) |
+                                I2C_Distance_GET_I2C_CTRL_LOW_PHASE_OVS(I2C_BUS_OVS_LOW);
+    
+    I2C_Distance_Enable();
+    I2C_Distance_I2CMasterClearStatus();
+}
+
+// ============ 事务推进（中断上下文或临界区内调用） ============
+static void finish_active(uint8 result);
+
+static void start_active(void) {
+    I2cBusTxn* txn;
+    uint32 status;
+    
+    while(phase == PHASE_IDLE && active_index != submit_index) {
+        txn = &queue[active_index];
+        
+        I2C_Distance_I2CMasterClearStatus();
+        active_start_ms = timebase_ms();
+        
+        if(txn->tx_len > 0) {
+            // 有读阶段时不发STOP，随后以重复START读取
+            phase = PHASE_WRITE;
+            status = I2C_Distance_I2CMasterWriteBuf(txn->addr, txn->tx, txn->tx_len,
+                txn->rx_len ? I2C_Distance_I2C_MODE_NO_STOP : I2C_Distance_I2C_MODE_COMPLETE_XFER);
+        } else {
+            phase = PHASE_READ;
+            status = I2C_Distance_I2CMasterReadBuf(txn->addr, txn->rx, txn->rx_len,
+                                                   I2C_Distance_I2C_MODE_COMPLETE_XFER);
+        }
+        
+        if(status != I2C_Distance_I2C_MSTR_NO_ERROR) {
+            finish_active(I2C_BUS_ERR_BUS);     // 继续尝试下一个事务
+        }
+    }
+}
+
+static void finish_active(uint8 result) {
+    queue[active_index].result = result;
+    if(result != I2C_BUS_OK) {
+        error_count++;
+        if(result == I2C_BUS_ERR_NAK) {
+            nak_count++;
+        }
+    }
+    I2C_Distance_I2CMasterClearStatus();
+    phase = PHASE_IDLE;
+    active_index = QUEUE_NEXT(active_index);
+    if(notify_fn != NULL) {
+        notify_fn();
+    }
+}
+
+// 根据主机状态推进当前事务
+static void advance(void) {
+    I2cBusTxn* txn = &queue[active_index];
+    uint32 status;
+    
+    if(phase == PHASE_IDLE) {
+        return;
+    }
+    
+    status = I2C_Distance_I2CMasterStatus();
+    if(status & I2C_Distance_I2C_MSTAT_ERR_MASK) {
+        finish_active((status & (I2C_Distance_I2C_MSTAT_ERR_ADDR_NAK | I2C_Distance_I2C_MSTAT_ERR_SHORT_XFER)) ?
+                      I2C_BUS_ERR_NAK : I2C_BUS_ERR_BUS);
+    } else if(phase == PHASE_WRITE && (status & I2C_Distance_I2C_MSTAT_WR_CMPLT)) {
+        if(txn->rx_len == 0) {
+            finish_active(I2C_BUS_OK);
+        } else {
+            I2C_Distance_I2CMasterClearStatus();
+            phase = PHASE_READ;
+            if(I2C_Distance_I2CMasterReadBuf(txn->addr, txn->rx, txn->rx_len,
+                                             I2C_Distance_I2C_MODE_REPEAT_START) != I2C_Distance_I2C_MSTR_NO_ERROR) {
+                finish_active(I2C_BUS_ERR_BUS);
+            }
+        }
+    } else if(phase == PHASE_READ && (status & I2C_Distance_I2C_MSTAT_RD_CMPLT)) {
+        finish_active(I2C_BUS_OK);
+    }
+    
+    start_active();
+}
+
+// SCB中断结束时由生成代码调用（见 cyapicallbacks.h）
+void I2C_Distance_I2C_ISR_ExitCallback(void) {
+    advance();
+}
+
+// ============ 对外接口 ============
+void i2c_bus_init(void) {
+    I2C_Distance_Start();
+    apply_fast_mode();
+    
+    submit_index = 0;
+    active_index = 0;
+    callback_index = 0;
+    phase = PHASE_IDLE;
+}
+
+// 事务完成（有回调等待 i2c_bus_poll() 执行）时调用 notify，通常在中断上下文
+void i2c_bus_set_notify(void (*notify)(void)) {
+    notify_fn = notify;
+}
+
+// 入队，slot 返回所用的槽（可为NULL）
+static uint8 enqueue(uint8 addr, const uint8* tx, uint8 tx_len, uint8 rx_len,
+                     I2cBusCallback callback, void* context, uint8* slot) {
+    I2cBusTxn* txn;
+    uint8 int_state;
+    
+    if(tx_len > I2C_BUS_MAX_TX || rx_len > I2C_BUS_MAX_RX || (tx_len == 0 && rx_len == 0)) {
+        return I2C_BUS_ERR_LENGTH;
+    }
+    
+    int_state = CyEnterCriticalSection();
+    
+    if(QUEUE_NEXT(submit_index) == callback_index) {
+        CyExitCriticalSection(int_state);
+        return I2C_BUS_ERR_QUEUE_FULL;
+    }
+    
+    txn = &queue[submit_index];
+    txn->addr = addr;
+    txn->tx_len = tx_len;
+    txn->rx_len = rx_len;
+    txn->result = I2C_BUS_OK;
+    txn->callback = callback;
+    txn->context = context;
+    if(tx_len > 0) {
+        memcpy(txn->tx, tx, tx_len);
+    }
+    if(slot != NULL) {
+        *slot = submit_index;
+    }
+    submit_index = QUEUE_NEXT(submit_index);
+    
+    start_active();
+    
+    CyExitCriticalSection(int_state);
+    
+    return I2C_BUS_OK;
+}
+
+// 提交事务：先写 tx_len 字节，再读 rx_len 字节（两者都非零时使用重复START）
+uint8 i2c_bus_submit(uint8 addr, const uint8* tx, uint8 tx_len, uint8 rx_len,
+                     I2cBusCallback callback, void* context) {
+    return enqueue(addr, tx, tx_len, rx_len, callback, context, NULL);
+}
+
+// 时钟延展或总线卡死时不会再有中断，超时复位并继续下一个事务
+static void check_timeout(void) {
+    uint8 int_state = CyEnterCriticalSection();
+    
+    if(phase != PHASE_IDLE && timebase_ms() - active_start_ms > I2C_BUS_TIMEOUT_MS) {
+        apply_fast_mode();
+        finish_active(I2C_BUS_ERR_TIMEOUT);
+        start_active();
+    }
+    CyExitCriticalSection(int_state);
+}
+
+// 主循环调用：处理超时，按提交顺序执行已完成事务的回调
+void i2c_bus_poll(void) {
+    I2cBusTxn* txn;
+    
+    check_timeout();
+    
+    while(callback_index != active_index) {
+        txn = &queue[callback_index];
+        if(txn->callback != NULL) {
+            txn->callback(txn->result, txn->rx, txn->rx_len, txn->context);
+        }
+        callback_index = QUEUE_NEXT(callback_index);
+    }
+}
+
+// 已提交但尚未执行回调的事务数
+uint8 i2c_bus_pending(void) {
+    return (uint8)((submit_index + I2C_BUS_QUEUE_SIZE - callback_index) % I2C_BUS_QUEUE_SIZE);
+}
+
+// ============ 阻塞式寄存器访问 ============
+// 槽已传输完成（位于 [callback_index, active_index) 中）
+static uint8 slot_done(uint8 slot) {
+    return (uint8)((slot + I2C_BUS_QUEUE_SIZE - callback_index) % I2C_BUS_QUEUE_SIZE) <
+           (uint8)((active_index + I2C_BUS_QUEUE_SIZE - callback_index) % I2C_BUS_QUEUE_SIZE);
+}
+
+// 排在前面的事务照常完成，但只取自己的结果；槽没有回调，由下一次 i2c_bus_poll() 释放
+static uint8 transfer_wait(uint8 addr, const uint8* tx, uint8 tx_len, uint8* rx, uint8 rx_len) {
+    I2cBusTxn* txn;
+    uint8 slot;
+    uint8 result;
+    
+    result = enqueue(addr, tx, tx_len, rx_len, NULL, NULL, &slot);
+    if(result != I2C_BUS_OK) {
+        return result;
+    }
+    while(!slot_done(slot)) {
+        check_timeout();
+    }
+    
+    txn = &queue[slot];
+    if(rx != NULL && txn->result == I2C_BUS_OK) {
+        memcpy(rx, txn->rx, rx_len);
+    }
+    return txn->result;
+}
+
+// 从 reg 开始连续写入 len 个寄存器
+uint8 i2c_bus_write_regs16(uint8 addr, uint16 reg, const uint8* data, uint8 len) {
+    uint8 buffer[I2C_BUS_MAX_TX];
+    
+    if(len == 0 || len > I2C_BUS_MAX_BURST) {
+        return I2C_BUS_ERR_LENGTH;
+    }
+    
+    buffer[0] = (uint8)(reg >> 8);
+    buffer[1] = (uint8)(reg & 0xFF);
+    memcpy(&buffer[2], data, len);
+    
+    return transfer_wait(addr, buffer, 2u + len, NULL, 0);
+}
+
+// 写寄存器地址后以重复START连续读出 len 个寄存器
+uint8 i2c_bus_read_regs16(uint8 addr, uint16 reg, uint8* data, uint8 len) {
+    uint8 reg_buf[2];
+    
+    if(len == 0) {
+        return I2C_BUS_ERR_LENGTH;
+    }
+    
+    reg_buf[0] = (uint8)(reg >> 8);
+    reg_buf[1] = (uint8)(reg & 0xFF);
+    
+    return transfer_wait(addr, reg_buf, sizeof(reg_buf), data, len);
+}
+
+uint8 i2c_bus_write_reg16(uint8 addr, uint16 reg, uint8 value) {
+    return i2c_bus_write_regs16(addr, reg, &value, 1);
+}
+
+uint32 i2c_bus_errors(void) {
+    return error_count;
+}
+
+uint32 i2c_bus_nak_count(void) {
+    return nak_count;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,56 @@
+/*
+ * i2c_bus.h - I2C_Distance总线：快速模式、异步事务队列、寄存器突发读写
+ *
+ * 原理图中 I2C_Distance 配置为100kHz，启动后在运行时改为400kHz
+ * （SCBCLK 8MHz，低/高相位过采样 13/7）。
+ *
+ * 调用者提交事务 {地址, 写数据, 读长度, 完成回调} 后立即返回，
+ * SCB中断结束时（I2C_Distance_I2C_ISR_EXIT_CALLBACK）推进当前事务并启动下一个，
+ * 总线传输不占用主循环。完成回调在主循环的 i2c_bus_poll() 中按提交顺序执行，
+ * 每个事务单独报告结果（NAK、总线错误、超时）。
+ * 可在中断中提交事务；阻塞式的寄存器读写接口只能在主循环中使用，
+ * 它只等待自己的事务，不执行其他事务的回调（不会重入异步驱动）。
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "project.h"
+
+#define I2C_BUS_RATE_KHZ        400
+#define I2C_BUS_QUEUE_SIZE      16      // 未完成事务数上限（含等待回调的），四路测距同时读取
+#define I2C_BUS_MAX_BURST       16      // 单次突发写入的最大数据字节数
+#define I2C_BUS_MAX_TX          (2 + I2C_BUS_MAX_BURST)     // 16位寄存器地址 + 数据
+#define I2C_BUS_MAX_RX          24
+#define I2C_BUS_TIMEOUT_MS      5       // 单个事务超时（含时钟延展）
+
+// 返回值 / 事务结果
+#define I2C_BUS_OK              0
+#define I2C_BUS_ERR_NAK         1       // 地址或数据未应答
+#define I2C_BUS_ERR_BUS         2       // 仲裁丢失、总线错误等
+#define I2C_BUS_ERR_TIMEOUT     3
+#define I2C_BUS_ERR_LENGTH      4
+#define I2C_BUS_ERR_QUEUE_FULL  5
+
+// 完成回调：result 为事务结果，rx 为读出的数据（rx_len 字节）
+typedef void (*I2cBusCallback)(uint8 result, const uint8* rx, uint8 rx_len, void* context);
+
+void i2c_bus_init(void);
+void i2c_bus_set_notify(void (*notify)(void));
+void i2c_bus_poll(void);
+
+uint8 i2c_bus_submit(uint8 addr, const uint8* tx, uint8 tx_len, uint8 rx_len,
+                     I2cBusCallback callback, void* context);
+uint8 i2c_bus_pending(void);
+
+// 阻塞式寄存器访问（16位寄存器地址，高字节在前），内部经由事务队列
+uint8 i2c_bus_write_regs16(uint8 addr, uint16 reg, const uint8* data, uint8 len);
+uint8 i2c_bus_read_regs16(uint8 addr, uint16 reg, uint8* data, uint8 len);
+uint8 i2c_bus_write_reg16(uint8 addr, uint16 reg, uint8 value);
+
+uint32 i2c_bus_errors(void);
+uint32 i2c_bus_nak_count(void);
+
+#endif /* I2C_BUS_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,98 @@
+/*
+ * timebase.c - 系统时间基准
+ */
+
+#include "timebase.h"
+
+#define TIMEBASE_SYSTICK_SLOT   3u
+
+#if defined(CY_TCPWM_Timer_1us_H)
+#define TIMEBASE_COUNTER_MASK   0xFFFFu
+#endif
+
+static volatile uint32 system_ms = 0;
+
+#if defined(CY_TCPWM_Timer_1us_H)
+// 计数器每5.46ms回绕一次，SysTick每1ms把增量并入32位微秒计数
+static volatile uint32 base_us = 0;         // 截至 last_count 的微秒数
+static volatile uint8 base_ticks = 0;       // 不足1us的余数（计数）
+static volatile uint16 last_count = 0;
+static volatile uint32 base_total_ticks = 0;  // 截至 last_count 的计数（约358秒回绕）
+#endif
+
+// ============ SysTick回调（中断上下文） ============
+static void timebase_tick(void) {
+#if defined(CY_TCPWM_Timer_1us_H)
+    uint16 count = (uint16)Timer_1us_ReadCounter();
+    uint32 delta = (uint32)(count - last_count) & TIMEBASE_COUNTER_MASK;
+    uint32 ticks = delta + base_ticks;
+    
+    last_count = count;
+    base_total_ticks += delta;
+    base_us += ticks / TIMEBASE_TICKS_PER_US;
+    base_ticks = (uint8)(ticks % TIMEBASE_TICKS_PER_US);
+#endif
+    system_ms++;
+}
+
+// Timer_1us 与 onewire 共用：onewire 使用比较中断，不改变计数和周期。
+// 生成的配置是捕获模式，不产生比较匹配中断，首次初始化后、使能前改为比较模式；
+// 已由 onewire_init() 启动时不重新使能，计数保持连续
+void timebase_init(void) {
+#if defined(CY_TCPWM_Timer_1us_H)
+    if(Timer_1us_initVar == 0u) {
+        Timer_1us_Init();
+        Timer_1us_initVar = 1u;
+        Timer_1us_SetMode(Timer_1us_MODE_TIMER_COMPARE);
+        Timer_1us_WritePeriod(TIMEBASE_COUNTER_MASK);
+        Timer_1us_Enable();
+    } else {
+        Timer_1us_SetMode(Timer_1us_MODE_TIMER_COMPARE);
+    }
+    last_count = (uint16)Timer_1us_ReadCounter();
+#endif
+    CySysTickStart();
+    CySysTickSetCallback(TIMEBASE_SYSTICK_SLOT, timebase_tick);
+}
+
+uint32 timebase_ms(void) {
+    return system_ms;
+}
+
+// 自由运行的微秒计数，回绕安全的差值可直接相减
+uint32 timebase_us(void) {
+#if defined(CY_TCPWM_Timer_1us_H)
+    uint8 int_state;
+    uint32 us;
+    uint32 ticks;
+    
+    // 读计数器与SysTick回调的更新不能交错
+    int_state = CyEnterCriticalSection();
+    ticks = ((uint32)((uint16)Timer_1us_ReadCounter() - last_count) & TIMEBASE_COUNTER_MASK) + base_ticks;
+    us = base_us;
+    CyExitCriticalSection(int_state);
+    
+    return us + ticks / TIMEBASE_TICKS_PER_US;
+#else
+    return system_ms * 1000u;
+#endif
+}
+
+// 自由运行的计数（TIMEBASE_TICKS_PER_US 个每微秒），用于测量短时间间隔，
+// 只做一次计数器读取和加法，不做除法
+uint32 timebase_ticks(void) {
+#if defined(CY_TCPWM_Timer_1us_H)
+    uint8 int_state;
+    uint32 ticks;
+    
+    int_state = CyEnterCriticalSection();
+    ticks = base_total_ticks + ((uint32)((uint16)Timer_1us_ReadCounter() - last_count) & TIMEBASE_COUNTER_MASK);
+    CyExitCriticalSection(int_state);
+    
+    return ticks;
+#else
+    return system_ms * 1000u;
+#endif
+}
+
+/* [] END OF FILE */
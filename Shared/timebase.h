@@ -0,0 +1,31 @@
+/*
+ * timebase.h - 系统时间基准
+ * SysTick每1ms中断一次，提供毫秒计数；
+ * 微秒计数由 Timer_1us 的16位自由运行计数器在SysTick回调中软件扩展为32位
+ * （约71.6分钟回绕一次），工程中没有 Timer_1us 时退化为毫秒计数 x 1000；
+ * timebase_ticks() 返回不换算为微秒的原始计数，用于开销很小的耗时测量
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "project.h"
+
+// timebase_ticks() 的计数频率
+#if defined(CY_TCPWM_Timer_1us_H)
+#define TIMEBASE_TICKS_PER_US   12u     // Clock_2 = 12MHz
+#else
+#define TIMEBASE_TICKS_PER_US   1u
+#endif
+
+void timebase_init(void);
+uint32 timebase_ms(void);
+uint32 timebase_us(void);
+uint32 timebase_ticks(void);
+
+// 回绕安全的时间比较：deadline 已到返回1
+#define TIMEBASE_EXPIRED(now, deadline)  ((int32)((now) - (deadline)) >= 0)
+
+#endif /* TIMEBASE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,1185 @@
+/*
+ * vl6180x.c - VL6180X距离传感器驱动（四通道连续测距，endedition与测试工程共用）
+ */
+
+#include "vl6180x.h"
+#include "i2c_bus.h"
+#include "timebase.h"
+
+#define SAMPLE_BUFFER_MASK      (VL6180X_SAMPLE_BUFFER_SIZE - 1)
+
+// RESULT_RANGE_STATUS 起连续5字节：测距状态、ALS状态、中断状态、ALS计数（16位）
+#define RESULT_BURST_LEN        5
+#define RESULT_BURST_RANGE_STATUS   0
+#define RESULT_BURST_ALS_STATUS     1
+#define RESULT_BURST_INT_STATUS     2
+#define RESULT_BURST_ALS_VAL        3
+
+#define BOOT_DELAY_MS           2       // GPIO0拉高后的启动时间（数据手册最大400us，含1ms计时误差）
+#define STOP_SETTLE_MS          60      // 停止连续测距后等待当前测量结束（最大收敛时间50ms，另加ALS积分时间）
+
+// 校准采集：距离值起连续6字节，返回率在 0x066
+#define CAL_READ_LEN            6
+#define CAL_READ_RETURN_RATE    4
+#define CAL_SKIP_SAMPLES        2       // 清零寄存器前已开始的测量不计入
+
+
+// GPIO1引脚及其中断由原理图生成，没有时退回按周期查询
+#if defined(CY_PINS_Pin_VL6180X_GPIO1_H) && defined(CY_ISR_isr_VL6180X_GPIO1_H)
+    #define VL6180X_USE_GPIO1   1
+#else
+    #define VL6180X_USE_GPIO1   0
+#endif
+
+// 四个传感器的GPIO0（关断控制）引脚，没有时只能识别默认地址上的一个传感器
+#if defined(CY_PINS_Pin_VL6180X_CE0_H) && defined(CY_PINS_Pin_VL6180X_CE1_H) && \
+    defined(CY_PINS_Pin_VL6180X_CE2_H) && defined(CY_PINS_Pin_VL6180X_CE3_H)
+    #define VL6180X_USE_CE      1
+#else
+    #define VL6180X_USE_CE      0
+#endif
+
+// 通道状态：启动流程按顺序推进，每个状态对应一个I2C事务或一段等待
+typedef enum {
+    CH_ABSENT,          // 未找到
+    CH_POWER_DOWN,      // GPIO0拉低，等待关断
+    CH_BOOT,            // GPIO0拉高，等待启动
+    CH_ASSIGN,          // 默认地址上写入通道地址
+    CH_STOP,            // 停止连续测距（无GPIO0时的重新初始化）
+    CH_STOP_SETTLE,
+    CH_CHECK_ID,
+    CH_CHECK_FRESH,
+    CH_DEFAULTS,        // ST私有寄存器设置
+    CH_CLEAR_FRESH,
+    CH_PARAMS,          // 测距参数
+    CH_CALIBRATION,     // 已保存的偏移/串扰校准值
+    CH_READY,           // 配置完成，等待启动测距
+    CH_RUNNING,
+    CH_RETRY_WAIT       // 重新初始化失败，稍后重试
+} Vl6180xChannelState;
+
+// 运行中通道的校准流程
+typedef enum {
+    CAL_IDLE,
+    CAL_READ_OFFSET,    // 保存当前偏移寄存器（可能是出厂值），失败时恢复
+    CAL_ZERO,           // 清零补偿寄存器
+    CAL_CAPTURE,        // 累计有效样本
+    CAL_APPLY,          // 写入新值
+    CAL_DONE,
+    CAL_FAILED
+} Vl6180xCalPhase;
+
+typedef struct {
+    uint8 addr;
+    volatile uint8 state;
+    uint8 setup_busy;                   // 启动流程的事务进行中
+    volatile uint8 read_in_flight;      // 样本读取事务链进行中
+    uint8 step;                         // DEFAULTS/PARAMS 表下标
+    uint8 step_len;                     // 当前突发写的寄存器数
+    uint8 period_changed;               // 测量间隔已修改，需要重写测距参数
+    uint16 start_reg;                   // 启动连续测量时写的寄存器，停止时写同一个
+    uint8 range_status;
+    uint32 lux_x10;                     // 当前样本周期的环境光
+    uint32 deadline_ms;
+    uint32 last_sample_ms;
+    uint32 ready_us;                    // 当前样本就绪的时间
+    uint8 history_count;                // 使能历史后的样本数（最多 VL6180X_HISTORY_DEPTH）
+    Vl6180xHealth health;
+    
+    // 校准
+    uint8 cal_phase;
+    uint8 cal_type;
+    uint8 cal_target_mm;
+    uint8 cal_skip;
+    uint8 cal_count;
+    uint8 cal_writes;                   // 未完成的寄存器写入
+    uint8 cal_saved_offset;
+    int32 cal_value;
+    uint32 cal_range_sum;
+    uint32 cal_rate_sum;
+    uint32 cal_deadline_ms;
+} Vl6180xChannel;
+
+// ============ 模块状态 ============
+static Vl6180xChannel channels[VL6180X_CHANNELS];
+static Vl6180xCalibration calibration[VL6180X_CHANNELS];     // 不随初始化清除
+static uint8 period_reg = 0;
+static uint8 als_integration_ms = 0;    // 0 = 不使用交错模式
+static uint16 poll_interval_ms = 0;
+static uint32 stall_ms = 0;
+static uint32 next_poll_ms = 0;
+static uint8 initializing = 0;          // 初始化期间失败的通道直接标记为未找到
+static uint8 ranging_enabled = 0;       // 允许 READY 通道启动测距
+static uint8 init_error = VL6180X_OK;
+
+static Vl6180xSample samples[VL6180X_SAMPLE_BUFFER_SIZE];
+static uint8 sample_head = 0;
+static uint8 sample_tail = 0;
+static uint32 dropped_count = 0;
+
+#if !VL6180X_USE_CE
+// ============ 寄存器访问（没有GPIO0时初始化查找传感器，阻塞） ============
+static uint8 write_byte(uint8 addr, uint16 reg_addr, uint8 data) {
+    return i2c_bus_write_reg16(addr, reg_addr, data);
+}
+
+static uint8 read_byte(uint8 addr, uint16 reg_addr, uint8* data) {
+    return i2c_bus_read_regs16(addr, reg_addr, data, 1);
+}
+#endif
+
+#if VL6180X_USE_CE
+// 拉低GPIO0使传感器进入关断（地址恢复为默认值）
+static void set_enabled(uint8 ch, uint8 enabled) {
+    switch(ch) {
+        case 0: Pin_VL6180X_CE0_Write(enabled); break;
+        case 1: Pin_VL6180X_CE1_Write(enabled); break;
+        case 2: Pin_VL6180X_CE2_Write(enabled); break;
+        case 3: Pin_VL6180X_CE3_Write(enabled); break;
+        default: break;
+    }
+}
+#endif
+
+// ============ 寄存器表 ============
+typedef struct {
+    uint16 reg;
+    uint8 value;
+} Vl6180xRegValue;
+
+// 必需的私有寄存器设置（来自ST应用笔记AN4545），保持ST给出的写入顺序
+static const Vl6180xRegValue default_config[] = {
+    { 0x0207, 0x01 }, { 0x0208, 0x01 },
+    { 0x0096, 0x00 }, { 0x0097, 0xfd },
+    { 0x00e3, 0x00 }, { 0x00e4, 0x04 }, { 0x00e5, 0x02 }, { 0x00e6, 0x01 }, { 0x00e7, 0x03 },
+    { 0x00f5, 0x02 },
+    { 0x00d9, 0x05 },
+    { 0x00db, 0xce }, { 0x00dc, 0x03 }, { 0x00dd, 0xf8 },
+    { 0x009f, 0x00 },
+    { 0x00a3, 0x3c },
+    { 0x00b7, 0x00 },
+    { 0x00bb, 0x3c },
+    { 0x00b2, 0x09 },
+    { 0x00ca, 0x09 },
+    { 0x0198, 0x01 },
+    { 0x01b0, 0x17 },
+    { 0x01ad, 0x00 },
+    { 0x00ff, 0x05 }, { 0x0100, 0x05 },
+    { 0x0199, 0x05 },
+    { 0x01a6, 0x1b },
+    { 0x01ac, 0x3e },
+    { 0x01a7, 0x1f },
+    { 0x0030, 0x00 }
+};
+
+#define DEFAULT_CONFIG_COUNT    (sizeof(default_config) / sizeof(default_config[0]))
+
+// 测距/ALS参数，每次启动都写入；测量间隔、积分时间和交错模式在运行时填入（param_value）
+static const Vl6180xRegValue range_config[] = {
+    { VL6180X_READOUT_AVERAGING_PERIOD, 0x30 },         // 读出平均 4.3ms（ST推荐值）
+    { VL6180X_SYSRANGE_VHV_REPEAT_RATE, 0xFF },         // 每255次测量自动温度校准
+    { VL6180X_SYSRANGE_VHV_RECALIBRATE, 0x01 },         // 立即校准一次
+    { VL6180X_SYSRANGE_MAX_CONVERGENCE_TIME, 0x32 },    // 最大收敛时间50ms
+    { VL6180X_SYSRANGE_RANGE_CHECK_ENABLES, 0x10 | 0x01 },
+    { VL6180X_SYSTEM_MODE_GPIO1, VL6180X_GPIO1_INTERRUPT_OUTPUT },  // 开漏，可线与
+    // 只用测距的新样本中断：交错模式下同一周期的ALS先完成，读测距时一并取出
+    { VL6180X_SYSTEM_INTERRUPT_CONFIG_GPIO, VL6180X_INT_NEW_SAMPLE_READY },
+    { VL6180X_SYSRANGE_INTERMEASUREMENT_PERIOD, 0x00 },
+    { VL6180X_SYSALS_ANALOGUE_GAIN, VL6180X_ALS_GAIN },
+    { VL6180X_SYSALS_INTEGRATION_PERIOD, 0x00 },        // 高字节，积分时间不超过256ms
+    { VL6180X_SYSALS_INTEGRATION_PERIOD + 1, 0x00 },
+    { VL6180X_SYSALS_INTERMEASUREMENT_PERIOD, 0x00 },
+    { VL6180X_INTERLEAVED_MODE_ENABLE, 0x00 },
+    { VL6180X_SYSTEM_HISTORY_CTRL, VL6180X_HISTORY_RANGE_ENABLE | VL6180X_HISTORY_CLEAR },
+    { VL6180X_SYSTEM_HISTORY_CTRL, VL6180X_HISTORY_RANGE_ENABLE },
+    { VL6180X_SYSTEM_INTERRUPT_CLEAR, VL6180X_INT_CLEAR_ALL }
+};
+
+#define RANGE_CONFIG_COUNT      (sizeof(range_config) / sizeof(range_config[0]))
+
+// ============ 启动流程（异步状态机） ============
+static void setup_done(uint8 result, const uint8* rx, uint8 rx_len, void* context);
+
+static uint8 channel_index(const Vl6180xChannel* channel) {
+    return (uint8)(channel - channels);
+}
+
+// range_config 中运行时确定的值
+static uint8 param_value(uint8 step) {
+    switch(range_config[step].reg) {
+        case VL6180X_SYSRANGE_INTERMEASUREMENT_PERIOD:
+        case VL6180X_SYSALS_INTERMEASUREMENT_PERIOD:
+            return period_reg;
+        case VL6180X_SYSALS_INTEGRATION_PERIOD + 1:
+            return als_integration_ms ? (uint8)(als_integration_ms - 1) : 0;
+        case VL6180X_INTERLEAVED_MODE_ENABLE:
+            return als_integration_ms ? 1 : 0;
+        default:
+            return range_config[step].value;
+    }
+}
+
+// 连续测量的启动/停止寄存器：交错模式由ALS启动，测距跟随
+static uint16 start_register(void) {
+    return als_integration_ms ? VL6180X_SYSALS_START : VL6180X_SYSRANGE_START;
+}
+
+static void enter_state(Vl6180xChannel* channel, Vl6180xChannelState state, uint16 wait_ms) {
+    channel->state = state;
+    channel->step = 0;
+    channel->deadline_ms = timebase_ms() + wait_ms;
+}
+
+// 从头开始启动流程：有GPIO0时重新上电，否则先停止测距再重写配置
+static void begin_setup(Vl6180xChannel* channel) {
+#if VL6180X_USE_CE
+    set_enabled(channel_index(channel), 0);
+    enter_state(channel, CH_POWER_DOWN, BOOT_DELAY_MS);
+#else
+    enter_state(channel, CH_STOP, 0);
+#endif
+}
+
+static void setup_failed(Vl6180xChannel* channel, uint8 error) {
+#if VL6180X_USE_CE
+    // 保持关断，避免占用默认地址
+    set_enabled(channel_index(channel), 0);
+#endif
+    if(initializing) {
+        init_error = error;
+        channel->state = CH_ABSENT;
+    } else {
+        enter_state(channel, CH_RETRY_WAIT, VL6180X_RETRY_MS);
+    }
+}
+
+static void request_reinit(Vl6180xChannel* channel) {
+    // 重新初始化会写回已保存的校准值，进行中的校准作废
+    if(channel->cal_phase != CAL_IDLE && channel->cal_phase != CAL_DONE) {
+        channel->cal_phase = CAL_FAILED;
+    }
+    channel->health.reinits++;
+    channel->health.consecutive_errors = 0;
+    begin_setup(channel);
+}
+
+// 同一时刻只能有一个传感器在默认地址上
+static uint8 default_address_in_use(const Vl6180xChannel* except) {
+    uint8 ch;
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        if(&channels[ch] != except &&
+           (channels[ch].state == CH_BOOT || channels[ch].state == CH_ASSIGN)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 提交当前状态对应的事务；队列满时保持原状态，下次 poll 重试
+static void submit_step(Vl6180xChannel* channel) {
+    uint8 tx[I2C_BUS_MAX_TX];
+    uint8 tx_len = 3;
+    uint8 rx_len = 0;
+    uint8 addr = channel->addr;
+    uint16 reg;
+    uint8 len;
+    
+    switch(channel->state) {
+        case CH_ASSIGN:
+            addr = VL6180X_I2C_ADDR;
+            reg = VL6180X_I2C_SLAVE_DEVICE_ADDRESS;
+            tx[2] = channel->addr;
+            break;
+        case CH_STOP:
+            reg = channel->start_reg;
+            tx[2] = VL6180X_RANGE_STOP;
+            break;
+        case CH_CHECK_ID:
+            reg = VL6180X_IDENTIFICATION_MODEL_ID;
+            tx_len = 2;
+            rx_len = 1;
+            break;
+        case CH_CHECK_FRESH:
+            reg = VL6180X_SYSTEM_FRESH_OUT_OF_RESET;
+            tx_len = 2;
+            rx_len = 1;
+            break;
+        case CH_DEFAULTS:
+            // 表中相邻且地址连续的寄存器合并为一次突发写（30次写入合并为21次传输）
+            reg = default_config[channel->step].reg;
+            len = 0;
+            do {
+                tx[2 + len] = default_config[channel->step + len].value;
+                len++;
+            } while(channel->step + len < DEFAULT_CONFIG_COUNT && len < I2C_BUS_MAX_BURST &&
+                    default_config[channel->step + len].reg == reg + len);
+            channel->step_len = len;
+            tx_len = (uint8)(2 + len);
+            break;
+        case CH_CLEAR_FRESH:
+            reg = VL6180X_SYSTEM_FRESH_OUT_OF_RESET;
+            tx[2] = 0x00;
+            break;
+        case CH_PARAMS:
+            reg = range_config[channel->step].reg;
+            tx[2] = param_value(channel->step);
+            break;
+        case CH_CALIBRATION:
+            // step 0 = 偏移，1 = 串扰；没有保存值的项跳过
+            if(channel->step == 0 && !(calibration[channel_index(channel)].flags & VL6180X_CALIB_OFFSET_VALID)) {
+                channel->step++;
+            }
+            if(channel->step == 1 && !(calibration[channel_index(channel)].flags & VL6180X_CALIB_CROSSTALK_VALID)) {
+                channel->step++;
+            }
+            if(channel->step == 0) {
+                reg = VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET;
+                tx[2] = (uint8)calibration[channel_index(channel)].offset_mm;
+            } else if(channel->step == 1) {
+                reg = VL6180X_SYSRANGE_CROSSTALK_COMPENSATION_RATE;
+                tx[2] = (uint8)(calibration[channel_index(channel)].crosstalk_rate >> 8);
+                tx[3] = (uint8)(calibration[channel_index(channel)].crosstalk_rate & 0xFF);
+                tx_len = 4;
+            } else {
+                enter_state(channel, CH_READY, 0);
+                return;
+            }
+            break;
+        case CH_READY:
+            reg = start_register();
+            tx[2] = VL6180X_RANGE_START_CONTINUOUS;
+            break;
+        default:
+            return;
+    }
+    tx[0] = (uint8)(reg >> 8);
+    tx[1] = (uint8)(reg & 0xFF);
+    
+    channel->setup_busy = 1;
+    if(i2c_bus_submit(addr, tx, tx_len, rx_len, setup_done, channel) != I2C_BUS_OK) {
+        channel->setup_busy = 0;
+    }
+}
+
+// 启动流程事务完成（主循环中由 i2c_bus_poll() 调用）
+static void setup_done(uint8 result, const uint8* rx, uint8 rx_len, void* context) {
+    Vl6180xChannel* channel = (Vl6180xChannel*)context;
+    (void)rx_len;
+    
+    channel->setup_busy = 0;
+    if(result != I2C_BUS_OK) {
+        setup_failed(channel, VL6180X_ERR_BUS);
+        return;
+    }
+    
+    switch(channel->state) {
+        case CH_ASSIGN:
+            enter_state(channel, CH_CHECK_ID, 0);
+            break;
+        case CH_STOP:
+            // 修改测量间隔时ALS积分时间可能已经变化，按停止前的模式等待
+            enter_state(channel, CH_STOP_SETTLE, STOP_SETTLE_MS +
+                        ((channel->start_reg == VL6180X_SYSALS_START) ? VL6180X_ALS_INTEGRATION_MAX_MS : 0));
+            break;
+        case CH_CHECK_ID:
+            if(rx[0] != VL6180X_MODEL_ID) {
+                setup_failed(channel, VL6180X_ERR_ID);
+            } else {
+                enter_state(channel, CH_CHECK_FRESH, 0);
+            }
+            break;
+        case CH_CHECK_FRESH:
+            // 私有寄存器只在复位后写入一次
+            enter_state(channel, (rx[0] == 1) ? CH_DEFAULTS : CH_PARAMS, 0);
+            break;
+        case CH_DEFAULTS:
+            channel->step += channel->step_len;
+            if(channel->step >= DEFAULT_CONFIG_COUNT) {
+                enter_state(channel, CH_CLEAR_FRESH, 0);
+            }
+            break;
+        case CH_CLEAR_FRESH:
+            enter_state(channel, CH_PARAMS, 0);
+            break;
+        case CH_PARAMS:
+            channel->step++;
+            if(channel->step >= RANGE_CONFIG_COUNT) {
+                enter_state(channel, CH_CALIBRATION, 0);
+            }
+            break;
+        case CH_CALIBRATION:
+            channel->step++;
+            break;
+        case CH_READY:
+            channel->start_reg = start_register();
+            channel->health.consecutive_errors = 0;
+            channel->history_count = 0;
+            channel->last_sample_ms = timebase_ms();
+            channel->state = CH_RUNNING;
+            break;
+        default:
+            break;
+    }
+}
+
+// ============ 校准（运行中进行，寄存器写入与样本读取共用事务队列） ============
+static void cal_write_done(uint8 result, const uint8* rx, uint8 rx_len, void* context);
+
+static uint8 submit_reg_write(Vl6180xChannel* channel, uint16 reg, uint16 value, uint8 len,
+                              I2cBusCallback callback) {
+    uint8 tx[4];
+    
+    tx[0] = (uint8)(reg >> 8);
+    tx[1] = (uint8)(reg & 0xFF);
+    if(len == 2) {
+        tx[2] = (uint8)(value >> 8);
+        tx[3] = (uint8)(value & 0xFF);
+    } else {
+        tx[2] = (uint8)value;
+    }
+    if(callback != NULL) {
+        channel->cal_writes++;
+    }
+    if(i2c_bus_submit(channel->addr, tx, (uint8)(2 + len), 0, callback, channel) != I2C_BUS_OK) {
+        if(callback != NULL) {
+            channel->cal_writes--;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+// 失败时恢复校准前的补偿寄存器
+static void cal_fail(Vl6180xChannel* channel) {
+    const Vl6180xCalibration* cal = &calibration[channel_index(channel)];
+    
+    if(channel->cal_phase == CAL_ZERO || channel->cal_phase == CAL_CAPTURE || channel->cal_phase == CAL_APPLY) {
+        submit_reg_write(channel, VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET, channel->cal_saved_offset, 1, NULL);
+        submit_reg_write(channel, VL6180X_SYSRANGE_CROSSTALK_COMPENSATION_RATE,
+                         (cal->flags & VL6180X_CALIB_CROSSTALK_VALID) ? cal->crosstalk_rate : 0, 2, NULL);
+    }
+    channel->cal_phase = CAL_FAILED;
+}
+
+static void cal_offset_read_done(uint8 result, const uint8* rx, uint8 rx_len, void* context) {
+    Vl6180xChannel* channel = (Vl6180xChannel*)context;
+    uint8 ok = 1;
+    (void)rx_len;
+    
+    if(channel->cal_phase != CAL_READ_OFFSET) {
+        return;
+    }
+    if(result != I2C_BUS_OK || channel->state != CH_RUNNING) {
+        channel->cal_phase = CAL_FAILED;
+        return;
+    }
+    
+    // 偏移校准时串扰补偿也必须为0；串扰校准保留偏移
+    channel->cal_saved_offset = rx[0];
+    channel->cal_phase = CAL_ZERO;
+    channel->cal_writes = 0;
+    if(channel->cal_type == VL6180X_CAL_OFFSET) {
+        ok = submit_reg_write(channel, VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET, 0, 1, cal_write_done);
+    }
+    if(ok) {
+        ok = submit_reg_write(channel, VL6180X_SYSRANGE_CROSSTALK_COMPENSATION_RATE, 0, 2, cal_write_done);
+    }
+    if(!ok) {
+        cal_fail(channel);
+    }
+}
+
+static void cal_write_done(uint8 result, const uint8* rx, uint8 rx_len, void* context) {
+    Vl6180xChannel* channel = (Vl6180xChannel*)context;
+    Vl6180xCalibration* cal = &calibration[channel_index(channel)];
+    (void)rx;
+    (void)rx_len;
+    
+    if(channel->cal_writes > 0) {
+        channel->cal_writes--;
+    }
+    if(channel->cal_phase != CAL_ZERO && channel->cal_phase != CAL_APPLY) {
+        return;
+    }
+    if(result != I2C_BUS_OK) {
+        cal_fail(channel);
+        return;
+    }
+    if(channel->cal_writes > 0) {
+        return;
+    }
+    
+    if(channel->cal_phase == CAL_ZERO) {
+        channel->cal_skip = CAL_SKIP_SAMPLES;
+        channel->cal_count = 0;
+        channel->cal_range_sum = 0;
+        channel->cal_rate_sum = 0;
+        channel->cal_phase = CAL_CAPTURE;
+    } else if(channel->cal_type == VL6180X_CAL_OFFSET) {
+        // 串扰已被清零，原有的串扰校准失效
+        cal->offset_mm = (int8)channel->cal_value;
+        cal->crosstalk_rate = 0;
+        cal->flags = (uint8)((cal->flags | VL6180X_CALIB_OFFSET_VALID) & ~VL6180X_CALIB_CROSSTALK_VALID);
+        channel->cal_phase = CAL_DONE;
+    } else {
+        cal->crosstalk_rate = (uint16)channel->cal_value;
+        cal->flags |= VL6180X_CALIB_CROSSTALK_VALID;
+        channel->cal_phase = CAL_DONE;
+    }
+}
+
+// 采集够样本后计算补偿值（AN4545）：
+//   偏移 = 目标距离 - 平均距离
+//   串扰 = 平均返回率 x (1 - 平均距离 / 目标距离)
+static void cal_apply(Vl6180xChannel* channel) {
+    int32 target_x10 = (int32)channel->cal_target_mm * 10;
+    int32 range_x10 = (int32)((channel->cal_range_sum * 10u + VL6180X_CAL_SAMPLES / 2) / VL6180X_CAL_SAMPLES);
+    int32 value;
+    uint8 ok;
+    
+    channel->cal_phase = CAL_APPLY;
+    if(channel->cal_type == VL6180X_CAL_OFFSET) {
+        value = target_x10 - range_x10;
+        value = (value >= 0) ? (value + 5) / 10 : (value - 5) / 10;
+        if(value > 127) {
+            value = 127;
+        } else if(value < -128) {
+            value = -128;
+        }
+        ok = submit_reg_write(channel, VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET, (uint8)(int8)value, 1, cal_write_done);
+    } else {
+        value = 0;
+        if(range_x10 < target_x10) {
+            value = (int32)((channel->cal_rate_sum / VL6180X_CAL_SAMPLES) * (uint32)(target_x10 - range_x10) /
+                            (uint32)target_x10);
+        }
+        if(value > 0xFFFF) {
+            value = 0xFFFF;
+        }
+        ok = submit_reg_write(channel, VL6180X_SYSRANGE_CROSSTALK_COMPENSATION_RATE, (uint16)value, 2, cal_write_done);
+    }
+    channel->cal_value = value;
+    if(!ok) {
+        cal_fail(channel);
+    }
+}
+
+// 每个完成的样本调用；rx 为距离值起 CAL_READ_LEN 字节
+static void cal_capture(Vl6180xChannel* channel, const uint8* rx, uint8 rx_len, uint8 error_code) {
+    if(channel->cal_phase != CAL_CAPTURE || rx_len < CAL_READ_LEN) {
+        return;
+    }
+    if(channel->cal_skip > 0) {
+        channel->cal_skip--;
+        return;
+    }
+    if(error_code != 0) {
+        return;
+    }
+    channel->cal_range_sum += rx[0];
+    channel->cal_rate_sum += ((uint16)rx[CAL_READ_RETURN_RATE] << 8) | rx[CAL_READ_RETURN_RATE + 1];
+    if(++channel->cal_count >= VL6180X_CAL_SAMPLES) {
+        cal_apply(channel);
+    }
+}
+
+// 推进一个通道的启动流程，运行中的通道检查是否停止出样本
+static void poll_channel(Vl6180xChannel* channel) {
+    uint32 now = timebase_ms();
+    
+    if(channel->setup_busy || channel->read_in_flight) {
+        return;
+    }
+    
+    // 已写过测距参数但尚未运行的通道从参数开始重写；更早的状态之后会写入新值
+    if(channel->period_changed) {
+        channel->period_changed = 0;
+        if(channel->state == CH_PARAMS || channel->state == CH_CALIBRATION || channel->state == CH_READY) {
+            enter_state(channel, CH_PARAMS, 0);
+        }
+    }
+    
+    switch(channel->state) {
+        case CH_ABSENT:
+            break;
+#if VL6180X_USE_CE
+        case CH_POWER_DOWN:
+            if(TIMEBASE_EXPIRED(now, channel->deadline_ms) && !default_address_in_use(channel)) {
+                set_enabled(channel_index(channel), 1);
+                enter_state(channel, CH_BOOT, BOOT_DELAY_MS);
+            }
+            break;
+        case CH_BOOT:
+            if(TIMEBASE_EXPIRED(now, channel->deadline_ms)) {
+                enter_state(channel, CH_ASSIGN, 0);
+                submit_step(channel);
+            }
+            break;
+#endif
+        case CH_STOP_SETTLE:
+            if(TIMEBASE_EXPIRED(now, channel->deadline_ms)) {
+                enter_state(channel, CH_CHECK_ID, 0);
+                submit_step(channel);
+            }
+            break;
+        case CH_RETRY_WAIT:
+            if(TIMEBASE_EXPIRED(now, channel->deadline_ms)) {
+                begin_setup(channel);
+            }
+            break;
+        case CH_READY:
+            if(ranging_enabled) {
+                submit_step(channel);
+            }
+            break;
+        case CH_RUNNING:
+            if(now - channel->last_sample_ms > stall_ms) {
+                request_reinit(channel);
+            } else if(channel->cal_phase >= CAL_READ_OFFSET && channel->cal_phase <= CAL_APPLY &&
+                      TIMEBASE_EXPIRED(now, channel->cal_deadline_ms)) {
+                cal_fail(channel);
+            }
+            break;
+        default:
+            submit_step(channel);
+            break;
+    }
+}
+
+// 初始化期间：是否还有通道在启动流程中
+static uint8 setup_pending(uint8 include_ready) {
+    uint8 ch;
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        if(channels[ch].state != CH_ABSENT && channels[ch].state != CH_RUNNING &&
+           (include_ready || channels[ch].state != CH_READY)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ============ 样本读取 ============
+static void push_sample(uint8 ch, uint8 range_mm, uint8 error_code, uint32 lux_x10, uint32 ready_us) {
+    Vl6180xSample* sample = &samples[sample_head];
+    
+    sample->time_ms = timebase_ms();
+    sample->time_us = ready_us;
+    sample->channel = ch;
+    sample->range_mm = range_mm;
+    sample->error_code = error_code;
+    sample->lux_x10 = lux_x10;
+    
+    sample_head = (sample_head + 1) & SAMPLE_BUFFER_MASK;
+    if(sample_head == sample_tail) {
+        // 缓冲区满，丢弃最旧的样本
+        sample_tail = (sample_tail + 1) & SAMPLE_BUFFER_MASK;
+        dropped_count++;
+    }
+}
+
+// 连续错误计数，达到阈值时重新初始化
+static void record_error(Vl6180xChannel* channel) {
+    if(++channel->health.consecutive_errors >= VL6180X_REINIT_ERRORS) {
+        request_reinit(channel);
+    }
+}
+
+// ALS计数换算为0.1lux：lux = 0.32 x 计数 x (100ms / 积分时间) / 增益
+// 计数最大65535，乘以32000仍在32位范围内
+static uint32 als_lux_x10(uint16 count) {
+    static const uint16 gain_x100[8] = { 2000, 1032, 521, 260, 172, 128, 101, 4000 };
+    
+    return (uint32)count * (VL6180X_ALS_LUX_RES_X1000 * 100u) /
+           ((uint32)als_integration_ms * gain_x100[VL6180X_ALS_GAIN & 0x07]);
+}
+
+// 样本读取是一串异步事务：状态突发读 -> 距离值读 -> 清中断，
+// 回调在主循环的 i2c_bus_poll() 中执行，总线传输期间主循环不等待
+static void range_read_done(uint8 result, const uint8* rx, uint8 rx_len, void* context) {
+    Vl6180xChannel* channel = (Vl6180xChannel*)context;
+    uint8 error_code;
+    
+    channel->read_in_flight = 0;
+    if(channel->state != CH_RUNNING) {
+        return;
+    }
+    if(result != I2C_BUS_OK) {
+        channel->health.bus_errors++;
+        record_error(channel);
+        return;
+    }
+    
+    error_code = (channel->range_status >> 4) & 0x0F;
+    channel->last_sample_ms = timebase_ms();
+    if(channel->history_count < VL6180X_HISTORY_DEPTH) {
+        channel->history_count++;
+    }
+    cal_capture(channel, rx, rx_len, error_code);
+    if(error_code == 0) {
+        channel->health.samples++;
+        channel->health.consecutive_errors = 0;
+    } else {
+        channel->health.range_errors++;
+        // 无目标、超量程是测量结果，只有硬件类错误说明传感器异常
+        if(vl6180x_error_class(error_code) == VL6180X_CLASS_SYSTEM) {
+            record_error(channel);
+        } else {
+            channel->health.consecutive_errors = 0;
+        }
+    }
+    push_sample(channel_index(channel), rx[0], error_code, channel->lux_x10, channel->ready_us);
+}
+
+static void gpio1_recheck(void);
+
+// 清中断完成：本通道已释放GPIO1
+static void int_clear_done(uint8 result, const uint8* rx, uint8 rx_len, void* context) {
+    (void)result;
+    (void)rx;
+    (void)rx_len;
+    (void)context;
+    gpio1_recheck();
+}
+
+static void status_read_done(uint8 result, const uint8* rx, uint8 rx_len, void* context) {
+    static const uint8 range_reg[2] = {
+        (uint8)(VL6180X_RESULT_RANGE_VAL >> 8), (uint8)(VL6180X_RESULT_RANGE_VAL & 0xFF)
+    };
+    static const uint8 clear_cmd[3] = {
+        (uint8)(VL6180X_SYSTEM_INTERRUPT_CLEAR >> 8), (uint8)(VL6180X_SYSTEM_INTERRUPT_CLEAR & 0xFF),
+        VL6180X_INT_CLEAR_ALL
+    };
+    Vl6180xChannel* channel = (Vl6180xChannel*)context;
+    (void)rx_len;
+    
+    if(result != I2C_BUS_OK) {
+        channel->read_in_flight = 0;
+        if(channel->state == CH_RUNNING) {
+            channel->health.bus_errors++;
+            record_error(channel);
+        }
+        return;
+    }
+    
+    // 查询模式和线与的GPIO1都不能说明是哪个传感器就绪，逐个检查中断状态
+    if(channel->state != CH_RUNNING || !(rx[RESULT_BURST_INT_STATUS] & VL6180X_INT_NEW_SAMPLE_READY)) {
+        channel->read_in_flight = 0;
+        return;
+    }
+    
+    // 样本的时间取状态读完成时，不含后续读距离事务的排队时间
+    channel->ready_us = timebase_us();
+    
+    // 校准采集时连同返回率一起读出
+    channel->range_status = rx[RESULT_BURST_RANGE_STATUS];
+    channel->lux_x10 = VL6180X_LUX_INVALID;
+    if(als_integration_ms && (rx[RESULT_BURST_ALS_STATUS] >> 4) == 0) {
+        channel->lux_x10 = als_lux_x10(((uint16)rx[RESULT_BURST_ALS_VAL] << 8) | rx[RESULT_BURST_ALS_VAL + 1]);
+    }
+    if(i2c_bus_submit(channel->addr, range_reg, sizeof(range_reg),
+                      (channel->cal_phase == CAL_CAPTURE) ? CAL_READ_LEN : 1,
+                      range_read_done, channel) != I2C_BUS_OK) {
+        channel->read_in_flight = 0;
+        return;
+    }
+    // 队列按顺序执行，清中断一定在读距离之后
+    i2c_bus_submit(channel->addr, clear_cmd, sizeof(clear_cmd), 0, int_clear_done, NULL);
+}
+
+// 主循环或GPIO1中断中调用：为每个空闲的运行中通道提交状态读取
+static void start_sample_reads(void) {
+    static const uint8 status_reg[2] = {
+        (uint8)(VL6180X_RESULT_RANGE_STATUS >> 8), (uint8)(VL6180X_RESULT_RANGE_STATUS & 0xFF)
+    };
+    Vl6180xChannel* channel;
+    uint8 ch;
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        channel = &channels[ch];
+        if(channel->state != CH_RUNNING || channel->read_in_flight) {
+            continue;
+        }
+        channel->read_in_flight = 1;
+        if(i2c_bus_submit(channel->addr, status_reg, sizeof(status_reg), RESULT_BURST_LEN,
+                          status_read_done, channel) != I2C_BUS_OK) {
+            channel->read_in_flight = 0;
+        }
+    }
+}
+
+#if VL6180X_USE_GPIO1
+// ============ GPIO1中断：有传感器的新样本就绪（低电平有效），直接提交读取事务 ============
+static CY_ISR(vl6180x_gpio1_isr) {
+    Pin_VL6180X_GPIO1_ClearInterrupt();
+    start_sample_reads();
+}
+#endif
+
+// 四个传感器的GPIO1线与，中断只在下降沿触发：一个传感器拉低期间另一个就绪不会产生新的边沿。
+// 清中断后线仍为低时说明还有通道就绪，再提交一轮读取（与中断互斥）
+static void gpio1_recheck(void) {
+#if VL6180X_USE_GPIO1
+    uint8 int_state;
+    
+    if(!ranging_enabled || Pin_VL6180X_GPIO1_Read() != 0) {
+        return;
+    }
+    int_state = CyEnterCriticalSection();
+    start_sample_reads();
+    CyExitCriticalSection(int_state);
+#endif
+}
+
+// 测量间隔寄存器：(值+1) x 10ms，交错模式时测距之外的余量用于ALS积分
+static void apply_period(uint16 period_ms) {
+    if(period_ms < 10) {
+        period_ms = 10;
+    } else if(period_ms > 2550) {
+        period_ms = 2550;
+    }
+    period_reg = (uint8)(period_ms / 10 - 1);
+    poll_interval_ms = (uint16)((period_reg + 1u) * 10u / 2u);
+    als_integration_ms = 0;
+    if(period_ms >= VL6180X_ALS_PERIOD_MS_MIN) {
+        als_integration_ms = (period_ms - VL6180X_ALS_RANGE_TIME_MS > VL6180X_ALS_INTEGRATION_MAX_MS) ?
+                             VL6180X_ALS_INTEGRATION_MAX_MS : (uint8)(period_ms - VL6180X_ALS_RANGE_TIME_MS);
+    }
+    stall_ms = (uint32)(period_reg + 1u) * 10u * VL6180X_STALL_PERIODS;
+}
+
+// ============ 对外接口 ============
+// 为各通道分配地址、写入配置，然后同时启动连续测距（各通道测量重叠进行）
+// 启动流程与运行中的重新初始化相同，这里循环推进直到全部完成
+uint8 vl6180x_init(uint16 period_ms) {
+    static const uint8 channel_addr[VL6180X_CHANNELS] = VL6180X_CHANNEL_ADDRS;
+    uint8 ch;
+#if !VL6180X_USE_CE
+    uint8 value;
+    uint8 assigned = 0;
+#endif
+    
+    ranging_enabled = 0;
+    initializing = 1;
+    init_error = VL6180X_ERR_BUS;
+    sample_head = 0;
+    sample_tail = 0;
+    dropped_count = 0;
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        channels[ch].addr = channel_addr[ch];
+        channels[ch].state = CH_ABSENT;
+        channels[ch].setup_busy = 0;
+        channels[ch].read_in_flight = 0;
+        channels[ch].period_changed = 0;
+        channels[ch].health.samples = 0;
+        channels[ch].health.range_errors = 0;
+        channels[ch].health.bus_errors = 0;
+        channels[ch].health.reinits = 0;
+        channels[ch].health.consecutive_errors = 0;
+        channels[ch].history_count = 0;
+        channels[ch].cal_phase = CAL_IDLE;
+    }
+    
+    apply_period(period_ms);
+    // 复位前的测量模式未知，无GPIO0时按当前设置停止
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        channels[ch].start_reg = start_register();
+    }
+    
+#if VL6180X_USE_CE
+    // 全部关断后逐个使能（default_address_in_use 保证每次只有一个在默认地址上）
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        begin_setup(&channels[ch]);
+    }
+#else
+    // 没有关断引脚：传感器在MCU复位后保留已分配的地址，先按通道地址查找
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        if(read_byte(channels[ch].addr, VL6180X_IDENTIFICATION_MODEL_ID, &value) == I2C_BUS_OK) {
+            begin_setup(&channels[ch]);
+        }
+    }
+    // 默认地址上最多只能区分一个传感器，分给第一个空闲通道
+    for(ch = 0; ch < VL6180X_CHANNELS && !assigned; ch++) {
+        if(channels[ch].state == CH_ABSENT) {
+            if(read_byte(VL6180X_I2C_ADDR, VL6180X_IDENTIFICATION_MODEL_ID, &value) == I2C_BUS_OK &&
+               write_byte(VL6180X_I2C_ADDR, VL6180X_I2C_SLAVE_DEVICE_ADDRESS, channels[ch].addr) == I2C_BUS_OK) {
+                enter_state(&channels[ch], CH_CHECK_ID, 0);
+            }
+            assigned = 1;
+        }
+    }
+#endif
+    
+    // 各通道配置交错进行，全部到达 READY 后再统一启动
+    while(setup_pending(0)) {
+        i2c_bus_poll();
+        vl6180x_poll();
+    }
+    
+    if(vl6180x_channel_mask() == 0) {
+        initializing = 0;
+        return init_error;
+    }
+    
+#if VL6180X_USE_GPIO1
+    isr_VL6180X_GPIO1_StartEx(vl6180x_gpio1_isr);
+#endif
+    
+    // 启动命令在队列中背靠背发出，各通道的测量时间基本对齐
+    ranging_enabled = 1;
+    while(setup_pending(1)) {
+        i2c_bus_poll();
+        vl6180x_poll();
+    }
+    initializing = 0;
+    
+    next_poll_ms = timebase_ms() + poll_interval_ms;
+    
+    return VL6180X_OK;
+}
+
+// 运行中修改测量间隔，不阻塞、不复位通道：
+// 运行中的通道经启动流程的 停止 -> 等待 -> 重写测距参数 -> 启动 异步完成，期间不出样本；
+// 尚在启动流程中的通道使用新值。校准进行中或没有通道时返回 VL6180X_ERR_STATE
+uint8 vl6180x_set_period(uint16 period_ms) {
+    Vl6180xChannel* channel;
+    uint8 ch;
+    
+    if(!ranging_enabled || vl6180x_channel_mask() == 0) {
+        return VL6180X_ERR_STATE;
+    }
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        if(channels[ch].cal_phase >= CAL_READ_OFFSET && channels[ch].cal_phase <= CAL_APPLY) {
+            return VL6180X_ERR_STATE;
+        }
+    }
+    
+    apply_period(period_ms);
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        channel = &channels[ch];
+        if(channel->state == CH_RUNNING) {
+            // 离开 RUNNING 后进行中的样本读取被丢弃，读取结束后 poll_channel 提交停止
+            enter_state(channel, CH_STOP, 0);
+        } else {
+            channel->period_changed = 1;
+        }
+    }
+    next_poll_ms = timebase_ms() + poll_interval_ms;
+    
+    return VL6180X_OK;
+}
+
+// 主循环调用：推进启动/重新初始化流程；查询模式下按周期提交样本读取（GPIO1模式由中断提交，线一直为低时按周期补查）
+void vl6180x_poll(void) {
+    uint8 ch;
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        poll_channel(&channels[ch]);
+    }
+    
+    if(!ranging_enabled || !TIMEBASE_EXPIRED(timebase_ms(), next_poll_ms)) {
+        return;
+    }
+    next_poll_ms = timebase_ms() + poll_interval_ms;
+    
+#if VL6180X_USE_GPIO1
+    // 后备：清中断事务提交失败等情况下线一直为低、不再有边沿，按周期检查
+    gpio1_recheck();
+#else
+    // 一次突发读同时取得测距状态和中断状态
+    start_sample_reads();
+#endif
+}
+
+// 已找到的通道位图（bit n = 通道n），包括正在重新初始化的
+uint8 vl6180x_channel_mask(void) {
+    uint8 mask = 0;
+    uint8 ch;
+    
+    for(ch = 0; ch < VL6180X_CHANNELS; ch++) {
+        if(channels[ch].state != CH_ABSENT) {
+            mask |= (uint8)(1u << ch);
+        }
+    }
+    return mask;
+}
+
+uint8 vl6180x_channel_address(uint8 channel) {
+    return (channel < VL6180X_CHANNELS) ? channels[channel].addr : 0;
+}
+
+// 通道状态的简短名称：ABSENT / INIT / RUN / RETRY
+const char* vl6180x_channel_state(uint8 channel) {
+    if(channel >= VL6180X_CHANNELS) {
+        return "ABSENT";
+    }
+    switch(channels[channel].state) {
+        case CH_ABSENT:     return "ABSENT";
+        case CH_RUNNING:    return "RUN";
+        case CH_RETRY_WAIT: return "RETRY";
+        default:            return "INIT";
+    }
+}
+
+// 实际使用的测量间隔（10ms取整）
+uint16 vl6180x_period_ms(void) {
+    return (uint16)((period_reg + 1u) * 10u);
+}
+
+// 交错模式下每周期的ALS积分时间，0 = 未启用
+uint8 vl6180x_als_integration_ms(void) {
+    return als_integration_ms;
+}
+
+const Vl6180xHealth* vl6180x_health(uint8 channel) {
+    return (channel < VL6180X_CHANNELS) ? &channels[channel].health : NULL;
+}
+
+// ============ 距离历史 ============
+// 一次突发读出片上历史，统计均值和方差（无目标的样本不计入）；阻塞，只在主循环中调用
+uint8 vl6180x_history_average(uint8 channel, Vl6180xAverage* average) {
+    uint8 history[VL6180X_HISTORY_DEPTH];
+    uint32 sum = 0;
+    uint32 sum_sq = 0;
+    uint8 n = 0;
+    uint8 i;
+    
+    if(channel >= VL6180X_CHANNELS || channels[channel].state != CH_RUNNING) {
+        return VL6180X_ERR_STATE;
+    }
+    if(channels[channel].history_count < VL6180X_HISTORY_DEPTH) {
+        return VL6180X_ERR_NO_DATA;
+    }
+    if(i2c_bus_read_regs16(channels[channel].addr, VL6180X_RESULT_HISTORY_BUFFER_0,
+                           history, VL6180X_HISTORY_DEPTH) != I2C_BUS_OK) {
+        return VL6180X_ERR_BUS;
+    }
+    
+    for(i = 0; i < VL6180X_HISTORY_DEPTH; i++) {
+        if(history[i] != VL6180X_RANGE_NO_TARGET) {
+            sum += history[i];
+            sum_sq += (uint32)history[i] * history[i];
+            n++;
+        }
+    }
+    if(n == 0) {
+        return VL6180X_ERR_NO_DATA;
+    }
+    
+    // 方差用 n-1（样本方差），最大值 16 x 65025 不会溢出
+    average->count = n;
+    average->mean_x100 = (int32)((sum * 100u + n / 2u) / n);
+    average->variance_x100 = (n > 1) ?
+        (int32)(((n * sum_sq - sum * sum) * 100u) / ((uint32)n * (n - 1u))) : 0;
+    
+    return VL6180X_OK;
+}
+
+// ============ 偏移/串扰校准 ============
+// 设置保存的校准值，在下一次（重新）初始化时写入传感器
+void vl6180x_set_calibration(uint8 channel, const Vl6180xCalibration* cal) {
+    if(channel < VL6180X_CHANNELS) {
+        calibration[channel] = *cal;
+    }
+}
+
+const Vl6180xCalibration* vl6180x_calibration(uint8 channel) {
+    return (channel < VL6180X_CHANNELS) ? &calibration[channel] : NULL;
+}
+
+// 开始校准：target_mm 为目标距离，0 使用ST推荐值。通过 vl6180x_calibration_status() 查询结果
+uint8 vl6180x_calibrate(uint8 channel, uint8 type, uint8 target_mm) {
+    static const uint8 offset_reg[2] = {
+        (uint8)(VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET >> 8),
+        (uint8)(VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET & 0xFF)
+    };
+    Vl6180xChannel* ch;
+    
+    if(channel >= VL6180X_CHANNELS || type > VL6180X_CAL_CROSSTALK) {
+        return VL6180X_ERR_STATE;
+    }
+    ch = &channels[channel];
+    if(ch->state != CH_RUNNING || vl6180x_calibration_status(channel) == VL6180X_CAL_RUNNING) {
+        return VL6180X_ERR_STATE;
+    }
+    if(target_mm == 0) {
+        target_mm = (type == VL6180X_CAL_OFFSET) ? VL6180X_CAL_OFFSET_TARGET_MM : VL6180X_CAL_CROSSTALK_TARGET_MM;
+    }
+    
+    ch->cal_type = type;
+    ch->cal_target_mm = target_mm;
+    ch->cal_writes = 0;
+    ch->cal_deadline_ms = timebase_ms() + (uint32)(period_reg + 1u) * 10u * VL6180X_CAL_TIMEOUT_PERIODS;
+    ch->cal_phase = CAL_READ_OFFSET;
+    if(i2c_bus_submit(ch->addr, offset_reg, sizeof(offset_reg), 1, cal_offset_read_done, ch) != I2C_BUS_OK) {
+        ch->cal_phase = CAL_IDLE;
+        return VL6180X_ERR_BUS;
+    }
+    return VL6180X_OK;
+}
+
+uint8 vl6180x_calibration_status(uint8 channel) {
+    if(channel >= VL6180X_CHANNELS) {
+        return VL6180X_CAL_IDLE;
+    }
+    switch(channels[channel].cal_phase) {
+        case CAL_IDLE:      return VL6180X_CAL_IDLE;
+        case CAL_DONE:      return VL6180X_CAL_DONE;
+        case CAL_FAILED:    return VL6180X_CAL_FAILED;
+        default:            return VL6180X_CAL_RUNNING;
+    }
+}
+
+// ============ 测距状态码 ============
+uint8 vl6180x_error_class(uint8 error_code) {
+    switch(error_code) {
+        case 0:
+            return VL6180X_CLASS_OK;
+        case 6: case 7: case 8: case 11:
+            return VL6180X_CLASS_NO_TARGET;
+        case 12: case 13: case 14: case 15:
+            return VL6180X_CLASS_RANGE;
+        default:
+            return VL6180X_CLASS_SYSTEM;
+    }
+}
+
+const char* vl6180x_error_name(uint8 error_code) {
+    switch(error_code) {
+        case 0:  return "No error";
+        case 1:  return "VCSEL continuity test";
+        case 2:  return "VCSEL watchdog test";
+        case 3:  return "VCSEL watchdog";
+        case 4:  return "PLL1 lock";
+        case 5:  return "PLL2 lock";
+        case 6:  return "Early convergence estimate";
+        case 7:  return "Max convergence";
+        case 8:  return "No target ignore";
+        case 11: return "Max SNR";
+        case 12: return "Raw ranging algo underflow";
+        case 13: return "Raw ranging algo overflow";
+        case 14: return "Ranging algo underflow";
+        case 15: return "Ranging algo overflow";
+        default: return "Unknown error";
+    }
+}
+
+uint8 vl6180x_sample_count(void) {
+    return (sample_head - sample_tail) & SAMPLE_BUFFER_MASK;
+}
+
+uint8 vl6180x_pop_sample(Vl6180xSample* sample) {
+    if(sample_head == sample_tail) {
+        return 0;
+    }
+    *sample = samples[sample_tail];
+    sample_tail = (sample_tail + 1) & SAMPLE_BUFFER_MASK;
+    return 1;
+}
+
+uint32 vl6180x_dropped(void) {
+    return dropped_count;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,196 @@
+/*
+ * vl6180x.h - VL6180X距离传感器驱动（四通道连续测距，endedition与测试工程共用）
+ *
+ * 四个传感器共用I2C_Distance总线，上电后都在默认地址0x29。
+ * 初始化时先全部拉低GPIO0关断，再逐个使能并通过 I2C_SLAVE__DEVICE_ADDRESS
+ * 分配各自的地址，配置完成后同时启动连续测距，四路测量时间重叠。
+ * 原理图中没有GPIO0引脚（Pin_VL6180X_CE0..3）时，只能识别默认地址上的
+ * 一个传感器（及之前已分配过地址、未断电的传感器）。
+ *
+ * 每个通道的启动流程（型号检查、FRESH_OUT_OF_RESET 时写入ST私有寄存器、
+ * 测距参数）是一个异步状态机，每步一个 i2c_bus 事务，由 vl6180x_poll() 推进。
+ * 运行中连续 VL6180X_REINIT_ERRORS 次总线错误或硬件类测距错误、或长时间没有
+ * 新样本时，该通道自动重新初始化，不阻塞主循环。
+ *
+ * 片上距离历史（最近16个样本）在启动时使能，vl6180x_history_average() 一次突发读出
+ * 并给出均值和方差。偏移（50mm白色目标）和串扰（100mm黑色目标）校准在连续测距
+ * 运行中进行，结果在每次（重新）初始化时写回传感器，保存由调用者负责。
+ *
+ * 测量间隔足够时（VL6180X_ALS_PERIOD_MS_MIN 以上）使用交错模式：每个测量周期先做一次
+ * 环境光（ALS）积分再测距，ALS结果与测距状态在同一次突发读中取出，不增加I2C事务；
+ * 积分时间取测量间隔扣除测距时间后的余量（最多100ms），换算为0.1lux随样本给出。
+ *
+ * 传感器以固定的测量间隔连续测距，每个新样本通过GPIO1拉低通知：
+ * 中断直接向 i2c_bus 队列提交读取事务，结果在 i2c_bus_poll() 的回调中存入样本缓冲区。
+ * 原理图中没有GPIO1引脚（Pin_VL6180X_GPIO1 + isr_VL6180X_GPIO1）时，
+ * 改为每半个测量周期查询一次中断状态，而不是每1ms查询。
+ *
+ * 依赖 i2c_bus（需在 cyapicallbacks.h 中启用 I2C_Distance_I2C_ISR_EXIT_CALLBACK）
+ * 和 timebase。
+ */
+
+#ifndef VL6180X_H
+#define VL6180X_H
+
+#include "project.h"
+
+#define VL6180X_I2C_ADDR                    0x29    // 上电默认地址
+#define VL6180X_MODEL_ID                    0xB4
+
+// 通道 0/1 = 上方两路，2/3 = 下方两路
+#define VL6180X_CHANNELS                    4
+#define VL6180X_CHANNEL_ADDRS               { 0x2A, 0x2B, 0x2C, 0x2D }
+
+// 系统寄存器
+#define VL6180X_IDENTIFICATION_MODEL_ID     0x000
+#define VL6180X_SYSTEM_MODE_GPIO1           0x011
+#define VL6180X_SYSTEM_HISTORY_CTRL         0x012
+#define VL6180X_SYSTEM_INTERRUPT_CONFIG_GPIO 0x014
+#define VL6180X_SYSTEM_INTERRUPT_CLEAR      0x015
+#define VL6180X_SYSTEM_FRESH_OUT_OF_RESET   0x016
+#define VL6180X_I2C_SLAVE_DEVICE_ADDRESS    0x212   // 7位地址，关断后恢复默认
+#define VL6180X_INTERLEAVED_MODE_ENABLE     0x2A3
+
+// 测距寄存器
+#define VL6180X_SYSRANGE_START              0x018
+#define VL6180X_SYSRANGE_INTERMEASUREMENT_PERIOD 0x01B
+#define VL6180X_SYSRANGE_MAX_CONVERGENCE_TIME 0x01C
+#define VL6180X_SYSRANGE_CROSSTALK_COMPENSATION_RATE 0x01E  // 16位，9.7定点 MCPS
+#define VL6180X_SYSRANGE_PART_TO_PART_RANGE_OFFSET 0x024    // int8，mm，上电时从NVM载入出厂值
+#define VL6180X_SYSRANGE_RANGE_CHECK_ENABLES 0x02D
+#define VL6180X_SYSRANGE_VHV_RECALIBRATE    0x02E
+#define VL6180X_SYSRANGE_VHV_REPEAT_RATE    0x031
+#define VL6180X_READOUT_AVERAGING_PERIOD    0x10A
+
+// 环境光寄存器
+#define VL6180X_SYSALS_START                0x038
+#define VL6180X_SYSALS_INTERMEASUREMENT_PERIOD 0x03E   // 交错模式下决定整个测量周期
+#define VL6180X_SYSALS_ANALOGUE_GAIN        0x03F
+#define VL6180X_SYSALS_INTEGRATION_PERIOD   0x040   // 16位，(值+1) ms
+
+// 结果寄存器
+#define VL6180X_RESULT_RANGE_STATUS         0x04D
+#define VL6180X_RESULT_ALS_STATUS           0x04E
+#define VL6180X_RESULT_INTERRUPT_STATUS_GPIO 0x04F
+#define VL6180X_RESULT_ALS_VAL              0x050   // 16位，ALS计数
+#define VL6180X_RESULT_HISTORY_BUFFER_0     0x052   // 8个16位寄存器，测距模式下每字节一个距离
+#define VL6180X_RESULT_RANGE_VAL            0x062
+#define VL6180X_RESULT_RANGE_RETURN_RATE    0x066   // 16位，9.7定点 MCPS
+
+// 寄存器取值
+#define VL6180X_RANGE_START_CONTINUOUS      0x03    // 启动 + 连续模式
+#define VL6180X_RANGE_STOP                  0x01    // 连续模式下再次写1停止
+#define VL6180X_GPIO1_INTERRUPT_OUTPUT      0x10
+#define VL6180X_INT_NEW_SAMPLE_READY        0x04
+#define VL6180X_INT_CLEAR_ALL               0x07
+#define VL6180X_HISTORY_RANGE_ENABLE        0x01    // bit0 使能，bit1 = 0 记录测距
+#define VL6180X_HISTORY_CLEAR               0x04
+#define VL6180X_RANGE_NO_TARGET             255     // 无目标时的距离值
+
+// 连续测距参数
+#define VL6180X_PERIOD_MS_DEFAULT           100     // 测量间隔（10ms为单位，10~2550ms），留出ALS积分时间
+#define VL6180X_SAMPLE_BUFFER_SIZE          32      // 四个通道共用，必须是2的幂
+#define VL6180X_HISTORY_DEPTH               16      // 片上距离历史样本数
+
+// 环境光（交错模式）
+#define VL6180X_ALS_GAIN                    0x46    // 模拟增益1.01（bit6必须为1）
+#define VL6180X_ALS_RANGE_TIME_MS           60      // 每周期留给测距的时间（最大收敛50ms + 读出平均）
+#define VL6180X_ALS_INTEGRATION_MIN_MS      20      // 余量不足时不启用ALS
+#define VL6180X_ALS_INTEGRATION_MAX_MS      100     // ST推荐的积分时间
+#define VL6180X_ALS_PERIOD_MS_MIN           (VL6180X_ALS_RANGE_TIME_MS + VL6180X_ALS_INTEGRATION_MIN_MS)
+#define VL6180X_ALS_LUX_RES_X1000           320     // 增益1、积分100ms时每个计数0.32lux（无盖板）
+#define VL6180X_LUX_INVALID                 0xFFFFFFFFu
+
+// 校准（ST应用笔记AN4545的流程）
+#define VL6180X_CAL_OFFSET                  0
+#define VL6180X_CAL_CROSSTALK               1
+#define VL6180X_CAL_OFFSET_TARGET_MM        50      // 白色（88%反射率）目标
+#define VL6180X_CAL_CROSSTALK_TARGET_MM     100     // 黑色（3%反射率）目标
+#define VL6180X_CAL_SAMPLES                 20      // 参与平均的有效样本数
+#define VL6180X_CAL_TIMEOUT_PERIODS         (VL6180X_CAL_SAMPLES * 4)
+
+// 校准状态
+#define VL6180X_CAL_IDLE                    0
+#define VL6180X_CAL_RUNNING                 1
+#define VL6180X_CAL_DONE                    2
+#define VL6180X_CAL_FAILED                  3
+
+// Vl6180xCalibration.flags
+#define VL6180X_CALIB_OFFSET_VALID          0x01
+#define VL6180X_CALIB_CROSSTALK_VALID       0x02
+
+// 健康监测
+#define VL6180X_REINIT_ERRORS               10      // 连续错误达到此数时重新初始化
+#define VL6180X_STALL_PERIODS               10      // 超过此数个测量周期无新样本视为失效
+#define VL6180X_RETRY_MS                    500     // 重新初始化失败后的重试间隔
+
+// 返回值
+#define VL6180X_OK                          0
+#define VL6180X_ERR_ID                      1
+#define VL6180X_ERR_BUS                     2
+#define VL6180X_ERR_STATE                   3       // 通道未运行或校准进行中
+#define VL6180X_ERR_NO_DATA                 4       // 历史未填满或没有有效距离
+
+// 测距状态码（RESULT_RANGE_STATUS[7:4]）的分类
+#define VL6180X_CLASS_OK                    0
+#define VL6180X_CLASS_SYSTEM                1       // VCSEL/PLL 硬件错误，计入健康监测
+#define VL6180X_CLASS_NO_TARGET             2       // 收敛失败、无目标、信噪比不足
+#define VL6180X_CLASS_RANGE                 3       // 测距算法上溢/下溢（超出量程）
+
+typedef struct {
+    uint32 time_ms;
+    uint32 time_us;         // 读到新样本就绪标志的时间（timebase_us）
+    uint8 channel;
+    uint8 range_mm;
+    uint8 error_code;       // RESULT_RANGE_STATUS[7:4]，0 = 有效
+    uint32 lux_x10;         // 同一周期的环境光，0.1lux；未启用或ALS出错时为 VL6180X_LUX_INVALID
+} Vl6180xSample;
+
+typedef struct {
+    uint32 samples;             // 有效样本
+    uint32 range_errors;        // 状态码非0的样本
+    uint32 bus_errors;          // 读取事务失败
+    uint16 reinits;             // 自动重新初始化次数
+    uint8 consecutive_errors;
+} Vl6180xHealth;
+
+// 未标记有效的项不写入传感器（偏移保持出厂值）
+typedef struct {
+    int8 offset_mm;
+    uint8 flags;
+    uint16 crosstalk_rate;      // 9.7定点 MCPS
+} Vl6180xCalibration;
+
+typedef struct {
+    uint8 count;                // 参与统计的历史样本数
+    int32 mean_x100;            // 均值，0.01mm
+    int32 variance_x100;        // 方差，0.01mm²
+} Vl6180xAverage;
+
+uint8 vl6180x_init(uint16 period_ms);
+uint8 vl6180x_set_period(uint16 period_ms);
+void vl6180x_poll(void);
+uint8 vl6180x_channel_mask(void);
+uint8 vl6180x_channel_address(uint8 channel);
+const char* vl6180x_channel_state(uint8 channel);
+const Vl6180xHealth* vl6180x_health(uint8 channel);
+uint8 vl6180x_als_integration_ms(void);
+uint16 vl6180x_period_ms(void);
+
+uint8 vl6180x_history_average(uint8 channel, Vl6180xAverage* average);
+
+void vl6180x_set_calibration(uint8 channel, const Vl6180xCalibration* calibration);
+const Vl6180xCalibration* vl6180x_calibration(uint8 channel);
+uint8 vl6180x_calibrate(uint8 channel, uint8 type, uint8 target_mm);
+uint8 vl6180x_calibration_status(uint8 channel);
+
+uint8 vl6180x_error_class(uint8 error_code);
+const char* vl6180x_error_name(uint8 error_code);
+
+uint8 vl6180x_sample_count(void);
+uint8 vl6180x_pop_sample(Vl6180xSample* sample);
+uint32 vl6180x_dropped(void);
+
+#endif /* VL6180X_H */
+
+/* [] END OF FILE */
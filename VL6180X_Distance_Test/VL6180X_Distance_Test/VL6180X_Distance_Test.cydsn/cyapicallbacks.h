@@ -16,6 +16,10 @@
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
 
+    /* I2C_Distance: i2c_bus.c drives its transaction queue from the SCB interrupt */
+    #define I2C_Distance_I2C_ISR_EXIT_CALLBACK
+    void I2C_Distance_I2C_ISR_ExitCallback(void);
+
     
 #endif /* CYAPICALLBACKS_H */   
 /* [] */